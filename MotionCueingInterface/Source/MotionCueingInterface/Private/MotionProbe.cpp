@@ -10,8 +10,10 @@
 
 // The low frequency function is TickComponent()
 // The high frequency function is TickController()
-// We interpolate between PreviousAverageHostData and CurrentAverageHostData 
-// This solution adds a lag equal to the low frequency interval (33ms -> 30 Hz) * TickControllerAverageCount
+// Both forward to FMotionRuntime, which interpolates between the previous and current averages
+// With UseOutputThread, TickController() is replaced by the runtime thread, so a game thread hitch
+// doesn't stop the output: the watchdog extrapolates, then washes back to neutral until fresh data arrives.
+// This solution adds a lag equal to the low frequency interval (33ms -> 30 Hz) * AverageCount
 // If lag is an issue, then we could lerp between CurrentData and a "PredictionData"
 
 // Sets default values for this component's properties
@@ -22,23 +24,27 @@ UMotionProbe::UMotionProbe()
 	PrimaryComponentTick.bAllowTickOnDedicatedServer = true;
 
 	NextTickTime = 0.033f;	// FORCED 30Hz
-	NextTickDT = 0.0f;
-	TickControllerCount = 0;
-	TickControllerAverageCount = 10;
 
 	OutputFrequency = 100;
-	TickControllerTotal = 0;
+	UseAdaptiveRate = false;
+	MinOutputFrequency = 100;
+	MaxOutputFrequency = 1000;
+	TimerFrequency = 0;
+	PoseIndex = 0;
 	ControllerIP = "127.0.0.1";
 	ControllerPort = 3000;
 	HostReceivePort = 3001;
 
 	UseDebugMode = true;
+	UseOutputThread = false;
+	WatchdogDeadline = 0.1f;
+	ExtrapolationTime = 0.2f;
+	WashoutEaseTime = 0.5f;
+	RecoveryTime = 0.5f;
+	PilotOffset = FVector::ZeroVector;
 	VibrationInput = EVibrationType::Acceleration;
 	VehicleType = EVehicleType::Car;
 	InterpolationType = EInterpolationType::Linear;
-
-	TickControllerCounter = 0;
-	Buffer.Reset();
 }
 
 // Called when the game starts
@@ -49,116 +55,67 @@ void UMotionProbe::BeginPlay()
 	// Clamp params
 	OutputFrequency = FMath::Clamp(OutputFrequency, 1, 1000);
 
-	// Reset
-	TickControllerTotal = 0;
-	TickControllerCounter = 0;
-	TickControllerCount = 0;
-	NextTickDT = 0.0f;
-	Buffer.Reset();
-	CurrentHostData.Reset();
-	PreviousHostData.Reset();
-	CurrentAverageHostData.Reset();
-	PreviousAverageHostData.Reset();
-
 	// Set low frequency timer for TickComponent()
 	PrimaryComponentTick.TickInterval = NextTickTime;
 
-	// Set high frequency timer for TickController()
-	TimerDel.BindUFunction(this, FName("TickController"));
-	GetWorld()->GetTimerManager().SetTimer(TimerHandle, TimerDel, 1.0f/OutputFrequency, true);
-
-	// Init Host interface 
-	HostInterface->Initialize();
+	// Init Host interface and connect to controller
+	Runtime = MakeUnique<FMotionRuntime>(&PoseQueue, OutputFrequency);
+	Runtime->SetWatchdog(WatchdogDeadline, ExtrapolationTime, WashoutEaseTime, RecoveryTime);
+	Runtime->SetPilotOffset(PilotOffset);
+	if (UseAdaptiveRate)
+	{
+		Runtime->SetAdaptiveRate(MinOutputFrequency, MaxOutputFrequency);
+	}
+	Runtime->Connect(ControllerIP, ControllerPort, HostReceivePort);
 
-	// Connect to controller
-	HostInterface->ConnectToController(ControllerIP, ControllerPort, HostReceivePort);
+	if (UseOutputThread)
+	{
+		// High frequency thread replaces TickController()
+		Runtime->Start(0);
+	}
+	else
+	{
+		// Set high frequency timer for TickController()
+		TimerDel.BindUFunction(this, FName("TickController"));
+		TimerFrequency = UseAdaptiveRate ? FMath::Clamp(OutputFrequency, MinOutputFrequency, MaxOutputFrequency) : OutputFrequency;
+		GetWorld()->GetTimerManager().SetTimer(TimerHandle, TimerDel, 1.0f/TimerFrequency, true);
+	}
 }
 
 // Called when the game ends
 void UMotionProbe::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
 	Super::EndPlay(EndPlayReason);
-	HostInterface->Cleanup();
 	GetWorld()->GetTimerManager().ClearTimer(TimerHandle);
+	if (Runtime.IsValid())
+	{
+		Runtime->Disconnect();
+		Runtime.Reset();
+	}
 }
 
 void UMotionProbe::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
 {
 	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
-	NextTickDT += DeltaTime;
-	if (NextTickDT > NextTickTime)
+	// Sampled, differentiated and averaged by the runtime
+	FMotionPose Pose;
+	Pose.Position = BaseObject->GetComponentLocation();
+	Pose.Rotation = BaseObject->GetComponentRotation();
+	Pose.DeltaTime = DeltaTime;
+	Pose.NumPoints = SamplePoints.Num();
+	for (int32 Index = 0; Index < Pose.NumPoints; Index++)
 	{
-		// How many times we tick the controller in that frame
-		TickControllerCounter += FMath::FloorToInt(NextTickDT * OutputFrequency);
-
-		// Save previous data since we interpolate between "previous" and "current"
-		PreviousHostData = CurrentHostData;
-
-		// Get current data
-		CurrentHostData.VehiclePosition = BaseObject->GetComponentLocation();
-		CurrentHostData.VehicleRotation = BaseObject->GetComponentRotation();
-
-		// Create vehicle reference frame
-		FTransform TM = FTransform();
-		TM.SetRotation(CurrentHostData.VehicleRotation.Quaternion());
-
-		// Calculate forward vector in vehicle space
-		FVector ForwardVector = CurrentHostData.VehiclePosition - PreviousHostData.VehiclePosition;
-		ForwardVector = TM.Inverse().TransformVector(ForwardVector);
-
-		// Vehicle Direction and Displacement
-		ForwardVector.ToDirectionAndLength(CurrentHostData.VehicleDirection, CurrentHostData.VehicleDisplacement);
-
-		// Vehicle Velocity
-		CurrentHostData.VehicleVelocity = CurrentHostData.VehicleDisplacement / NextTickDT;
-
-		// Vehicle Acceleration
-		CurrentHostData.VehicleAcceleration = (CurrentHostData.VehicleVelocity - PreviousHostData.VehicleVelocity) / NextTickDT;
-
-		// Kinematic velocity and acceleration per axis
-		CurrentHostData.VelocityX = (ForwardVector.X) / NextTickDT;	// forward speed
-		CurrentHostData.VelocityY = (ForwardVector.Y) / NextTickDT;	// side speed
-		CurrentHostData.VelocityZ = (ForwardVector.Z) / NextTickDT;	// up speed
-		CurrentHostData.AccelerationX = (CurrentHostData.VelocityX - PreviousHostData.VelocityX) / NextTickDT;	// forward acceleration
-		CurrentHostData.AccelerationY = (CurrentHostData.VelocityY - PreviousHostData.VelocityY) / NextTickDT;	// side acceleration
-		CurrentHostData.AccelerationZ = (CurrentHostData.VelocityZ - PreviousHostData.VelocityZ) / NextTickDT;	// up acceleration
-
-		// Rotational motion
-		CurrentHostData.PitchDisplacement = RotationalDeltaDeg(CurrentHostData.VehicleRotation.Pitch, PreviousHostData.VehicleRotation.Pitch);
-		CurrentHostData.RollDisplacement = RotationalDeltaDeg(CurrentHostData.VehicleRotation.Roll, PreviousHostData.VehicleRotation.Roll);
-		CurrentHostData.YawDisplacement = RotationalDeltaDeg(CurrentHostData.VehicleRotation.Yaw, PreviousHostData.VehicleRotation.Yaw);
-
-		CurrentHostData.PitchVelocity = CurrentHostData.PitchDisplacement / NextTickDT;
-		CurrentHostData.RollVelocity = CurrentHostData.RollDisplacement / NextTickDT;
-		CurrentHostData.YawVelocity = CurrentHostData.YawDisplacement / NextTickDT;
-
-		CurrentHostData.PitchAcceleration = (CurrentHostData.PitchVelocity - PreviousHostData.PitchVelocity) / NextTickDT;
-		CurrentHostData.RollAcceleration = (CurrentHostData.RollVelocity - PreviousHostData.RollVelocity) / NextTickDT;
-		CurrentHostData.YawAcceleration = (CurrentHostData.YawVelocity - PreviousHostData.YawVelocity) / NextTickDT;
-
-		// reset
-		NextTickDT = 0.0f;
-
-		// accumulate data in buffer to average over time
-		Buffer.Add(CurrentHostData);
-	}
-
-	// average over time
-	if (Buffer.Num() >= TickControllerAverageCount)
-	{
-		TickControllerTotal = TickControllerCounter;
-		TickControllerCounter = 0;
-		TickControllerCount = 0;
-		PreviousAverageHostData = CurrentAverageHostData;
-		CurrentAverageHostData.Reset();
-		for (FMotionData& Data : Buffer)
+		// Only read the points due this frame, the pipeline keeps the offset of the others
+		if (PoseIndex % SamplePointRateDivisors[Index] == 0)
 		{
-			CurrentAverageHostData = CurrentAverageHostData + Data;
+			// A destroyed point falls back to the vehicle origin so indices don't shift
+			Pose.PointPositions[Index] = IsValid(SamplePoints[Index]) ? SamplePoints[Index]->GetComponentLocation() : Pose.Position;
+			Pose.UpdatedPoints |= 1u << Index;
 		}
-		CurrentAverageHostData = CurrentAverageHostData / Buffer.Num();
-		Buffer.Empty();
 	}
+	PoseIndex++;
+	PoseQueue.Push(Pose);
 
 	// Debug print
 	if (UseDebugMode)
@@ -168,30 +125,31 @@ void UMotionProbe::TickComponent(float DeltaTime, ELevelTick TickType, FActorCom
 }
 
 // Will be called in a burst, not at equal intervals unfortunatly
-// Will need to add a delay to avoid burst effect?
+// Calls closer than half a period are collapsed, use UseOutputThread for a steady rate
 void UMotionProbe::TickController()
 {
-	// Interpolate data
-	float T = float(TickControllerCount) / float(TickControllerTotal - 1);
-	T = FMath::Clamp(T, 0.0f, 1.0f);
-	FMotionData InterpolatedData = InterpolateMotionData(PreviousAverageHostData, CurrentAverageHostData, T);
-
-	// receive data from controller
-	HostInterface->ReceiveDataFromController();
-
-	// go though the flow of state to control state machine
-	HostInterface->SetStateFlow();
-
-	// send data to controller
-	HostInterface->SendDataToController(InterpolatedData);
+	// Interpolate data, receive from and send to the controller
+	if (!Runtime->TickIfDue())
+	{
+		return;
+	}
 
-	TickControllerCount++;
+	// Follow the rate controller
+	const int Frequency = Runtime->GetStats().OutputFrequency;
+	if (Frequency != TimerFrequency)
+	{
+		TimerFrequency = Frequency;
+		GetWorld()->GetTimerManager().SetTimer(TimerHandle, TimerDel, 1.0f/TimerFrequency, true);
+	}
 }
 
 void UMotionProbe::DebugPrint(float DeltaTime)
 {
 	if (GEngine != nullptr)
 	{
+		const FMotionRuntimeStats Stats = Runtime.IsValid() ? Runtime->GetStats() : FMotionRuntimeStats();
+		const FMotionData& CurrentAverageHostData = Stats.CurrentAverage;
+
 		GEngine->AddOnScreenDebugMessage(15, DeltaTime, FColor::White, TEXT("Vehicle Roll accel (deg/s2): ") + GetFloatAsStringWithPrecision(CurrentAverageHostData.RollAcceleration, 2));
 		GEngine->AddOnScreenDebugMessage(14, DeltaTime, FColor::White, TEXT("Vehicle Pitch accel (deg/s2): ") + GetFloatAsStringWithPrecision(CurrentAverageHostData.PitchAcceleration, 2));
 		GEngine->AddOnScreenDebugMessage(13, DeltaTime, FColor::White, TEXT("Vehicle Yaw accel (deg/s2): ") + GetFloatAsStringWithPrecision(CurrentAverageHostData.YawAcceleration, 2));
@@ -208,11 +166,19 @@ void UMotionProbe::DebugPrint(float DeltaTime)
 		GEngine->AddOnScreenDebugMessage(8, DeltaTime, FColor::White, TEXT("Vehicle VelocityY (m/s): ") + GetFloatAsStringWithPrecision(CurrentAverageHostData.VelocityY*0.01f, 2));
 		GEngine->AddOnScreenDebugMessage(7, DeltaTime, FColor::White, TEXT("Vehicle VelocityX (m/s): ") + GetFloatAsStringWithPrecision(CurrentAverageHostData.VelocityX*0.01f, 2));
 
+		GEngine->AddOnScreenDebugMessage(20, DeltaTime, FColor::White, TEXT("Pilot specific force (m/s2): ") + (CurrentAverageHostData.SpecificForce * 0.01f).ToString());
+
 		GEngine->AddOnScreenDebugMessage(6, DeltaTime, FColor::White, TEXT("Vehicle Acceleration (m/s2): ") + GetFloatAsStringWithPrecision(CurrentAverageHostData.VehicleAcceleration*0.01f, 2));
 		GEngine->AddOnScreenDebugMessage(5, DeltaTime, FColor::White, TEXT("Vehicle Velocity (m/s): ") + GetFloatAsStringWithPrecision(CurrentAverageHostData.VehicleVelocity*0.01f, 2));
 
-		GEngine->AddOnScreenDebugMessage(1, DeltaTime, FColor::Red, TEXT("Current tick: ") + FString::FromInt(TickControllerCount));
-		GEngine->AddOnScreenDebugMessage(0, DeltaTime, FColor::Red, TEXT("Total Tick: ") + FString::FromInt(TickControllerTotal));
+		GEngine->AddOnScreenDebugMessage(1, DeltaTime, FColor::Red, TEXT("Current tick: ") + FString::FromInt(Stats.TickCount));
+		GEngine->AddOnScreenDebugMessage(0, DeltaTime, FColor::Red, TEXT("Total Tick: ") + FString::FromInt(Stats.TickTotal));
+
+		static const TCHAR* WatchdogStateNames[] = { TEXT("Live"), TEXT("Extrapolating"), TEXT("WashingOut") };
+		GEngine->AddOnScreenDebugMessage(16, DeltaTime, FColor::Red, TEXT("Watchdog: ") + FString(WatchdogStateNames[(uint8)Stats.WatchdogState]));
+		GEngine->AddOnScreenDebugMessage(17, DeltaTime, FColor::Red, FString::Printf(TEXT("Frames sent: %u, late ticks: %u"), Stats.Metrics.FramesSent, Stats.Metrics.LateTicks));
+		GEngine->AddOnScreenDebugMessage(19, DeltaTime, FColor::Red, FString::Printf(TEXT("Output rate: %d Hz, changes: %u, reason: %s"), Stats.OutputFrequency, Stats.Metrics.RateChanges, GetMotionRateReasonName(Stats.RateReason)));
+		GEngine->AddOnScreenDebugMessage(18, DeltaTime, FColor::Red, FString::Printf(TEXT("Deadline misses: %u, washouts: %u, recoveries: %u"), Stats.Metrics.DeadlineMisses, Stats.Metrics.Washouts, Stats.Metrics.Recoveries));
 	}
 }
 
@@ -220,3 +186,23 @@ void UMotionProbe::SetBaseObject(UMeshComponent* Input)
 {
 	BaseObject = Input;
 }
+
+int32 UMotionProbe::AddSamplePoint(USceneComponent* Point, int32 RateDivisor)
+{
+	if (!IsValid(Point) || SamplePoints.Num() >= MaxMotionSamplePoints)
+	{
+		return INDEX_NONE;
+	}
+	SamplePointRateDivisors.Add(FMath::Max(RateDivisor, 1));
+	return SamplePoints.Add(Point);
+}
+
+FVector UMotionProbe::GetSamplePointSpecificForce(int32 Index) const
+{
+	if (!Runtime.IsValid())
+	{
+		return FVector::ZeroVector;
+	}
+	const FMotionRuntimeStats Stats = Runtime->GetStats();
+	return Index >= 0 && Index < Stats.NumPoints ? Stats.Points[Index].SpecificForce : FVector::ZeroVector;
+}
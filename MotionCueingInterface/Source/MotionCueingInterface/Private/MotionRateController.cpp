@@ -0,0 +1,113 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "MotionRateController.h"
+
+FMotionRateController::FMotionRateController()
+{
+	MinFrequency = 100;
+	MaxFrequency = 1000;
+
+	MaxJitter = 0.1f;
+	MaxSendLoad = 0.5f;
+	MaxRoundTripTime = 0.01f;
+	MaxQueueDepth = 4;
+
+	EvaluationInterval = 0.5f;
+	DecreaseFactor = 0.75f;
+	IncreaseStep = 50;
+	HealthyEvaluations = 4;
+
+	Reset(MaxFrequency);
+}
+
+void FMotionRateController::Reset(int InFrequency)
+{
+	Frequency = FMath::Clamp(InFrequency, MinFrequency, MaxFrequency);
+	NominalFrequency = Frequency;
+	Reason = EMotionRateReason::None;
+	HealthyCount = 0;
+	ResetWindow(-1.0);
+}
+
+void FMotionRateController::ResetWindow(double Now)
+{
+	WindowStart = Now;
+	NumJitterTicks = 0;
+	JitterSum = 0.0f;
+	MaxSendDuration = 0.0f;
+	MaxRoundTrip = -1.0f;
+	MaxQueue = -1;
+}
+
+bool FMotionRateController::Update(double Now, float SendInterval, float SendDuration, const FMotionFeedback* Feedback)
+{
+	if (WindowStart < 0.0)
+	{
+		WindowStart = Now;
+	}
+
+	// Accumulate
+	const float Period = 1.0f / Frequency;
+	if (SendInterval >= 0.0f)
+	{
+		// Relative to the period, so the same limit holds at any rate
+		NumJitterTicks++;
+		JitterSum += FMath::Abs(SendInterval - Period) / Period;
+	}
+	MaxSendDuration = FMath::Max(MaxSendDuration, SendDuration);
+	if (Feedback != nullptr)
+	{
+		MaxRoundTrip = FMath::Max(MaxRoundTrip, Feedback->RoundTripTime);
+		MaxQueue = FMath::Max(MaxQueue, Feedback->QueueDepth);
+	}
+
+	if (Now - WindowStart < EvaluationInterval)
+	{
+		return false;
+	}
+
+	// Evaluate, the controller is checked first since it is what we want to protect
+	EMotionRateReason Overload = EMotionRateReason::None;
+	if (MaxQueueDepth >= 0 && MaxQueue > MaxQueueDepth)
+	{
+		Overload = EMotionRateReason::ControllerQueue;
+	}
+	else if (MaxRoundTripTime >= 0.0f && MaxRoundTrip > MaxRoundTripTime)
+	{
+		Overload = EMotionRateReason::RoundTrip;
+	}
+	else if (MaxSendLoad >= 0.0f && MaxSendDuration > MaxSendLoad * Period)
+	{
+		Overload = EMotionRateReason::HostOverload;
+	}
+	else if (MaxJitter >= 0.0f && NumJitterTicks > 0 && JitterSum / NumJitterTicks > MaxJitter)
+	{
+		Overload = EMotionRateReason::SendJitter;
+	}
+
+	// Above the configured rate, only the controller can tell it has room
+	const bool bHasFeedback = MaxRoundTrip >= 0.0f || MaxQueue >= 0;
+	ResetWindow(Now);
+
+	int NewFrequency = Frequency;
+	if (Overload != EMotionRateReason::None)
+	{
+		HealthyCount = 0;
+		NewFrequency = FMath::Max(FMath::FloorToInt(Frequency * DecreaseFactor), MinFrequency);
+	}
+	else if (++HealthyCount >= HealthyEvaluations)
+	{
+		HealthyCount = 0;
+		const int Limit = bHasFeedback ? MaxFrequency : FMath::Max(NominalFrequency, Frequency);
+		NewFrequency = FMath::Min(Frequency + IncreaseStep, Limit);
+	}
+
+	if (NewFrequency == Frequency)
+	{
+		return false;
+	}
+
+	Frequency = NewFrequency;
+	Reason = Overload != EMotionRateReason::None ? Overload : EMotionRateReason::Headroom;
+	return true;
+}
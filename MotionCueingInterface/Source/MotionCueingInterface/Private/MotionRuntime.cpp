@@ -0,0 +1,355 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "MotionRuntime.h"
+#include "Misc/FileHelper.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+#include "Common/UdpSocketBuilder.h"
+#include "Interfaces/IPv4/IPv4Address.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMotionRuntime, Log, All);
+
+// IMPLEMENTATION NOTE:
+// Poses come from a game thread queue, a socket or a log, and the controller is ticked
+// either by the owner (world timer) or by a dedicated thread that keeps a steady rate through game thread hitches.
+// Sampling and sending both happen in Tick(), so the pipeline needs no lock, only the stats copy does.
+
+// Time spent spinning before a tick instead of sleeping (s)
+static const double SpinTime = 0.001;
+
+// Receive buffer of FMotionPoseSocket (bytes)
+static const int32 MaxDatagramSize = 512;
+
+bool FMotionPoseLog::Load(const FString& Filename)
+{
+	TArray<FString> Lines;
+	if (!FFileHelper::LoadFileToStringArray(Lines, *Filename))
+	{
+		return false;
+	}
+
+	Entries.Reset();
+	for (const FString& Line : Lines)
+	{
+		TArray<FString> Values;
+		if (Line.ParseIntoArray(Values, TEXT(","), true) != 7 || !Values[0].IsNumeric())
+		{
+			// header or comment
+			continue;
+		}
+
+		FEntry Entry;
+		Entry.Time = FCString::Atod(*Values[0]);
+		Entry.Position = FVector(FCString::Atof(*Values[1]), FCString::Atof(*Values[2]), FCString::Atof(*Values[3]));
+		Entry.Rotation = FRotator(FCString::Atof(*Values[4]), FCString::Atof(*Values[5]), FCString::Atof(*Values[6]));
+		Entries.Add(Entry);
+	}
+
+	NextEntry = 0;
+	StartTime = -1.0;
+	return Entries.Num() > 0;
+}
+
+bool FMotionPoseLog::Poll(double Now, FMotionPose& Pose)
+{
+	if (NextEntry >= Entries.Num())
+	{
+		return false;
+	}
+
+	if (StartTime < 0.0)
+	{
+		StartTime = Now - Entries[0].Time;
+	}
+
+	const FEntry& Entry = Entries[NextEntry];
+	if (Entry.Time > Now - StartTime)
+	{
+		return false;
+	}
+
+	Pose.Position = Entry.Position;
+	Pose.Rotation = Entry.Rotation;
+	Pose.DeltaTime = NextEntry > 0 ? float(Entry.Time - Entries[NextEntry - 1].Time) : 0.0f;
+	NextEntry++;
+	return true;
+}
+
+bool FMotionPoseLog::IsFinished() const
+{
+	return NextEntry >= Entries.Num();
+}
+
+FMotionPoseSocket::~FMotionPoseSocket()
+{
+	if (Socket != nullptr)
+	{
+		Socket->Close();
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+	}
+}
+
+bool FMotionPoseSocket::Open(int32 Port)
+{
+	Socket = FUdpSocketBuilder(TEXT("MotionPoseSocket"))
+		.AsNonBlocking()
+		.BoundToAddress(FIPv4Address::InternalLoopback)
+		.BoundToPort(Port)
+		.Build();
+	return Socket != nullptr;
+}
+
+bool FMotionPoseSocket::Poll(double Now, FMotionPose& Pose)
+{
+	if (Socket == nullptr)
+	{
+		return false;
+	}
+
+	// Larger than a pose so longer datagrams are read whole and rejected, not truncated to a pose
+	// The pending size is not checked: on Windows it is every byte queued, not the next datagram
+	uint8 Datagram[MaxDatagramSize];
+	double Time;
+	float Values[6];
+	const int32 PoseSize = sizeof(Time) + sizeof(Values);
+	bool bReceived = false;
+	uint32 PendingSize = 0;
+	while (!bReceived && Socket->HasPendingData(PendingSize))
+	{
+		int32 BytesRead = 0;
+		if (!Socket->Recv(Datagram, sizeof(Datagram), BytesRead))
+		{
+			return false;
+		}
+
+		bReceived = BytesRead == PoseSize;
+		if (!bReceived)
+		{
+			// drop malformed datagram
+			UE_LOG(LogMotionRuntime, Verbose, TEXT("Dropped pose datagram of %d bytes"), BytesRead);
+		}
+	}
+
+	if (!bReceived)
+	{
+		return false;
+	}
+
+	FMemory::Memcpy(&Time, Datagram, sizeof(Time));
+	FMemory::Memcpy(Values, Datagram + sizeof(Time), sizeof(Values));
+	Pose.Position = FVector(Values[0], Values[1], Values[2]);
+	Pose.Rotation = FRotator(Values[3], Values[4], Values[5]);
+
+	// Sender time, so the pipeline doesn't see when we polled
+	Pose.DeltaTime = LastPoseTime < 0.0 ? 0.0f : FMath::Max(float(Time - LastPoseTime), 0.0f);
+	LastPoseTime = Time;
+	return true;
+}
+
+FMotionRuntime::FMotionRuntime(IMotionPoseSource* InSource, int InOutputFrequency)
+	: Source(InSource)
+{
+	// Clamp params
+	OutputFrequency = FMath::Clamp(InOutputFrequency, 1, 1000);
+	Pipeline.OutputFrequency = OutputFrequency;
+}
+
+FMotionRuntime::~FMotionRuntime()
+{
+	Disconnect();
+	delete HostInterface;
+}
+
+void FMotionRuntime::Connect(const FString& ControllerIP, int ControllerPort, int HostReceivePort)
+{
+	Pipeline.Reset();
+	Watchdog.Reset();
+	Metrics.Reset();
+	LastTickTime = -1.0;
+
+	// Init Host interface
+	HostInterface->Initialize();
+
+	// Connect to controller
+	HostInterface->ConnectToController(ControllerIP, ControllerPort, HostReceivePort);
+	bConnected = true;
+}
+
+void FMotionRuntime::Disconnect()
+{
+	if (Thread != nullptr)
+	{
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+
+	if (bConnected)
+	{
+		HostInterface->Cleanup();
+		bConnected = false;
+	}
+}
+
+void FMotionRuntime::SetWatchdog(float Deadline, float ExtrapolationTime, float WashoutEaseTime, float RecoveryTime)
+{
+	Watchdog.Deadline = Deadline;
+	Watchdog.ExtrapolationTime = ExtrapolationTime;
+	Watchdog.WashoutEaseTime = WashoutEaseTime;
+	Watchdog.RecoveryTime = RecoveryTime;
+}
+
+void FMotionRuntime::SetAdaptiveRate(int MinFrequency, int MaxFrequency)
+{
+	RateController.MinFrequency = FMath::Clamp(MinFrequency, 1, 1000);
+	RateController.MaxFrequency = FMath::Clamp(MaxFrequency, RateController.MinFrequency, 1000);
+	RateController.Reset(OutputFrequency);
+	bAdaptiveRate = true;
+
+	// Start within bounds
+	OutputFrequency = RateController.GetFrequency();
+	Pipeline.SetOutputFrequency(OutputFrequency);
+}
+
+void FMotionRuntime::SetPilotOffset(const FVector& PilotOffset)
+{
+	Pipeline.PilotOffset = PilotOffset;
+}
+
+void FMotionRuntime::Tick()
+{
+	const double TickStart = FPlatformTime::Seconds();
+
+	// Sample, differentiate and average the poses received since the previous tick
+	FMotionPose Pose;
+	while (Source->Poll(FPlatformTime::Seconds(), Pose))
+	{
+		if (Pipeline.AddPose(Pose))
+		{
+			Metrics.AveragesReceived++;
+		}
+	}
+
+	// Interpolate data, or extrapolate / wash out if it is late
+	FMotionData InterpolatedData = Watchdog.Update(Pipeline, FPlatformTime::Seconds(), Metrics);
+
+	// receive data from controller
+	HostInterface->ReceiveDataFromController();
+
+	// go though the flow of state to control state machine
+	HostInterface->SetStateFlow();
+
+	// sample points, if any
+	if (Pipeline.GetNumPoints() > 0)
+	{
+		HostInterface->SetSamplePoints(&Pipeline.GetPointData(0), Pipeline.GetNumPoints());
+	}
+
+	// send data to controller
+	HostInterface->SendDataToController(InterpolatedData);
+
+	// Adapt the rate to the send timing and the controller feedback
+	if (bAdaptiveRate)
+	{
+		const double TickEnd = FPlatformTime::Seconds();
+		// Only the runtime thread ticks at a steady interval, the world timer fires in bursts
+		const float SendInterval = !bOutputThread ? -1.0f : LastTickTime < 0.0 ? 1.0f / OutputFrequency : float(TickStart - LastTickTime);
+		FMotionFeedback Feedback;
+		const bool bHasFeedback = HostInterface->GetFeedback(Feedback);
+		if (RateController.Update(TickEnd, SendInterval, float(TickEnd - TickStart), bHasFeedback ? &Feedback : nullptr))
+		{
+			UE_LOG(LogMotionRuntime, Log, TEXT("Output rate %d -> %d Hz (%s)"), OutputFrequency, RateController.GetFrequency(), GetMotionRateReasonName(RateController.GetReason()));
+			OutputFrequency = RateController.GetFrequency();
+			Pipeline.SetOutputFrequency(OutputFrequency);
+			Metrics.RateChanges++;
+		}
+	}
+	LastTickTime = TickStart;
+
+	FScopeLock Lock(&StatsLock);
+	Stats.CurrentAverage = Pipeline.GetCurrentAverage();
+	Stats.TickCount = Pipeline.GetTickCount();
+	Stats.TickTotal = Pipeline.GetTickTotal();
+	Stats.WatchdogState = Watchdog.GetState();
+	Stats.Metrics = Metrics;
+	Stats.OutputFrequency = OutputFrequency;
+	Stats.RateReason = RateController.GetReason();
+	Stats.NumPoints = Pipeline.GetNumPoints();
+	for (int32 Index = 0; Index < Stats.NumPoints; Index++)
+	{
+		Stats.Points[Index] = Pipeline.GetPointData(Index);
+	}
+}
+
+bool FMotionRuntime::TickIfDue()
+{
+	// A looping timer fires every missed call in the same frame after a hitch, only the first one is sent
+	if (LastTickTime >= 0.0 && FPlatformTime::Seconds() - LastTickTime < 0.5 / OutputFrequency)
+	{
+		Metrics.LateTicks++;
+		return false;
+	}
+
+	Tick();
+	return true;
+}
+
+FMotionRuntimeStats FMotionRuntime::GetStats() const
+{
+	FScopeLock Lock(&StatsLock);
+	return Stats;
+}
+
+void FMotionRuntime::Start(uint64 AffinityMask)
+{
+	bStopping = false;
+	bRunning = true;
+	bOutputThread = true;
+	Thread = FRunnableThread::Create(this, TEXT("MotionRuntime"), 0, TPri_TimeCritical, AffinityMask != 0 ? AffinityMask : FPlatformAffinity::GetNoAffinityMask());
+}
+
+uint32 FMotionRuntime::Run()
+{
+	double NextTickTime = FPlatformTime::Seconds();
+
+	while (!bStopping && !Source->IsFinished())
+	{
+		Tick();
+
+		// Ticks missed by more than a period are skipped, never sent in a burst
+		// The period is read every tick since the rate controller can change it
+		const double Period = 1.0 / OutputFrequency;
+		NextTickTime += Period;
+		const double Now = FPlatformTime::Seconds();
+		if (NextTickTime < Now - Period)
+		{
+			UE_LOG(LogMotionRuntime, Verbose, TEXT("Controller tick late by %.2f ms"), (Now - NextTickTime) * 1000.0);
+			NextTickTime = Now;
+			Metrics.LateTicks++;
+		}
+		WaitUntil(NextTickTime);
+	}
+
+	bRunning = false;
+	return 0;
+}
+
+void FMotionRuntime::Stop()
+{
+	bStopping = true;
+}
+
+void FMotionRuntime::WaitUntil(double Time)
+{
+	const double SleepTime = Time - FPlatformTime::Seconds() - SpinTime;
+	if (SleepTime > 0.0)
+	{
+		FPlatformProcess::SleepNoStats(float(SleepTime));
+	}
+	while (FPlatformTime::Seconds() < Time)
+	{
+		FPlatformProcess::YieldThread();
+	}
+}
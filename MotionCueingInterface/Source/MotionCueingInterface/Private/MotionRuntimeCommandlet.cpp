@@ -0,0 +1,116 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "MotionRuntimeCommandlet.h"
+#include "MotionRuntime.h"
+#include "Misc/Parse.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMotionRuntimeCommandlet, Log, All);
+
+UMotionRuntimeCommandlet::UMotionRuntimeCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UMotionRuntimeCommandlet::Main(const FString& Params)
+{
+	FString LogFile;
+	int32 PosePort = 0;
+	int32 OutputFrequency = 100;
+	FString ControllerIP = TEXT("127.0.0.1");
+	int32 ControllerPort = 3000;
+	int32 HostReceivePort = 3001;
+	uint64 AffinityMask = 0;
+	float Duration = 0.0f;
+	const bool bAdaptiveRate = FParse::Param(*Params, TEXT("adaptive"));
+	int32 MinFrequency = 100;
+	int32 MaxFrequency = 1000;
+	float WatchdogDeadline = 0.1f;
+	float ExtrapolationTime = 0.2f;
+	float WashoutEaseTime = 0.5f;
+	float RecoveryTime = 0.5f;
+	FVector PilotOffset = FVector::ZeroVector;
+
+	// FParse::Value() matches anywhere in Params, the leading dash keeps "-port=" out of "-hostport=" and "-frequency=" out of "-maxfrequency="
+	FParse::Value(*Params, TEXT("-log="), LogFile);
+	FParse::Value(*Params, TEXT("-port="), PosePort);
+	FParse::Value(*Params, TEXT("-frequency="), OutputFrequency);
+	FParse::Value(*Params, TEXT("-controllerip="), ControllerIP);
+	FParse::Value(*Params, TEXT("-controllerport="), ControllerPort);
+	FParse::Value(*Params, TEXT("-hostport="), HostReceivePort);
+	FParse::Value(*Params, TEXT("-affinity="), AffinityMask);
+	FParse::Value(*Params, TEXT("-duration="), Duration);
+	FParse::Value(*Params, TEXT("-minfrequency="), MinFrequency);
+	FParse::Value(*Params, TEXT("-maxfrequency="), MaxFrequency);
+	FParse::Value(*Params, TEXT("-deadline="), WatchdogDeadline);
+	FParse::Value(*Params, TEXT("-extrapolation="), ExtrapolationTime);
+	FParse::Value(*Params, TEXT("-washoutease="), WashoutEaseTime);
+	FParse::Value(*Params, TEXT("-recovery="), RecoveryTime);
+	FParse::Value(*Params, TEXT("-pilotx="), PilotOffset.X);
+	FParse::Value(*Params, TEXT("-piloty="), PilotOffset.Y);
+	FParse::Value(*Params, TEXT("-pilotz="), PilotOffset.Z);
+
+	// Pose source
+	TUniquePtr<IMotionPoseSource> Source;
+	if (!LogFile.IsEmpty())
+	{
+		FMotionPoseLog* PoseLog = new FMotionPoseLog();
+		Source.Reset(PoseLog);
+		if (!PoseLog->Load(LogFile))
+		{
+			UE_LOG(LogMotionRuntimeCommandlet, Error, TEXT("Could not read poses from %s"), *LogFile);
+			return 1;
+		}
+	}
+	else if (PosePort > 0)
+	{
+		FMotionPoseSocket* PoseSocket = new FMotionPoseSocket();
+		Source.Reset(PoseSocket);
+		if (!PoseSocket->Open(PosePort))
+		{
+			UE_LOG(LogMotionRuntimeCommandlet, Error, TEXT("Could not listen for poses on port %d"), PosePort);
+			return 1;
+		}
+	}
+	else
+	{
+		UE_LOG(LogMotionRuntimeCommandlet, Error, TEXT("Usage: -run=MotionRuntime (-log=<file> | -port=<udp port>) [-frequency=100] [-controllerip=127.0.0.1] [-controllerport=3000] [-hostport=3001] [-affinity=<mask>] [-duration=<s>] [-adaptive [-minfrequency=100] [-maxfrequency=1000]] [-deadline=0.1] [-extrapolation=0.2] [-washoutease=0.5] [-recovery=0.5] [-pilotx=0] [-piloty=0] [-pilotz=0]"));
+		return 1;
+	}
+
+	// Run until the log is over, the duration is elapsed or exit is requested
+	FMotionRuntime Runtime(Source.Get(), OutputFrequency);
+	Runtime.SetWatchdog(WatchdogDeadline, ExtrapolationTime, WashoutEaseTime, RecoveryTime);
+	Runtime.SetPilotOffset(PilotOffset);
+	if (bAdaptiveRate)
+	{
+		Runtime.SetAdaptiveRate(MinFrequency, MaxFrequency);
+	}
+	Runtime.Connect(ControllerIP, ControllerPort, HostReceivePort);
+	Runtime.Start(AffinityMask);
+	UE_LOG(LogMotionRuntimeCommandlet, Display, TEXT("Motion runtime started at %d Hz"), OutputFrequency);
+
+	const double StartTime = FPlatformTime::Seconds();
+	while (Runtime.IsRunning() && !GIsRequestingExit)
+	{
+		if (Duration > 0.0f && FPlatformTime::Seconds() - StartTime > Duration)
+		{
+			break;
+		}
+		FPlatformProcess::Sleep(0.1f);
+	}
+
+	Runtime.Disconnect();
+
+	const FMotionRuntimeStats Stats = Runtime.GetStats();
+	const FMotionMetrics& Metrics = Stats.Metrics;
+	UE_LOG(LogMotionRuntimeCommandlet, Display, TEXT("Motion runtime stopped: %u frames sent, %u late ticks, %u deadline misses, %u washouts, %u recoveries"),
+		Metrics.FramesSent, Metrics.LateTicks, Metrics.DeadlineMisses, Metrics.Washouts, Metrics.Recoveries);
+	UE_LOG(LogMotionRuntimeCommandlet, Display, TEXT("Output rate %d Hz after %u changes, last reason: %s"),
+		Stats.OutputFrequency, Metrics.RateChanges, GetMotionRateReasonName(Stats.RateReason));
+	return 0;
+}
@@ -0,0 +1,160 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "MotionWireBenchmarkCommandlet.h"
+#include "MotionWireFormat.h"
+#include "MyMotionHost.h"
+#include "Misc/Parse.h"
+#include "HAL/PlatformTime.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMotionWireBenchmark, Log, All);
+
+static const uint32 BenchmarkChannels = MyMotionHost::Channels;
+
+typedef TMotionWireEncoder<BenchmarkChannels> FBenchmarkEncoder;
+typedef TMotionWireDecoder<BenchmarkChannels> FBenchmarkDecoder;
+
+UMotionWireBenchmarkCommandlet::UMotionWireBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UMotionWireBenchmarkCommandlet::Main(const FString& Params)
+{
+	int32 NumSamples = 100000;
+	int32 OutputFrequency = 1000;
+	float AckDelay = 20.0f;
+	int32 KeyframeInterval = 100;
+
+	// FParse::Value() matches anywhere in Params, the leading dash keeps "-frequency=" unique
+	FParse::Value(*Params, TEXT("-samples="), NumSamples);
+	FParse::Value(*Params, TEXT("-frequency="), OutputFrequency);
+	FParse::Value(*Params, TEXT("-ackdelay="), AckDelay);
+	FParse::Value(*Params, TEXT("-keyframeinterval="), KeyframeInterval);
+	NumSamples = FMath::Max(NumSamples, 1);
+	OutputFrequency = FMath::Clamp(OutputFrequency, 1, 1000);
+
+	// Round trip of an ack (ms), in packets
+	const int32 AckDelayPackets = FMath::Max(FMath::RoundToInt(AckDelay * 0.001f * OutputFrequency), 0);
+
+	// Synthetic drive: poses at 30 Hz through the pipeline, sampled at the output frequency
+	TArray<FMotionData> Samples;
+	Samples.Reserve(NumSamples);
+	{
+		FMyMotionPipeline Pipeline;
+		Pipeline.OutputFrequency = OutputFrequency;
+		float PoseTime = 0.0f;
+		for (int32 Index = 0; Index < NumSamples; Index++)
+		{
+			const float Time = float(Index) / OutputFrequency;
+			while (PoseTime <= Time)
+			{
+				const FVector Position(PoseTime * 2000.0f, FMath::Sin(PoseTime * 0.5f) * 3000.0f, FMath::Sin(PoseTime * 2.0f) * 20.0f);
+				const FRotator Rotation(FMath::Sin(PoseTime * 1.3f) * 5.0f, FMath::Fmod(PoseTime * 10.0f, 360.0f) - 180.0f, FMath::Sin(PoseTime * 3.1f) * 8.0f);
+				Pipeline.AddPose(Position, Rotation, 1.0f / 30.0f);
+				PoseTime += 1.0f / 30.0f;
+			}
+			Samples.Add(Pipeline.NextOutput());
+		}
+	}
+
+	const int32 NumFloats = MotionChannelFloatCount(BenchmarkChannels);
+	const int32 PlainSize = NumFloats * sizeof(float);
+	TArray<uint8> PlainPackets;
+	TArray<uint8> CompactPackets;
+	TArray<int32> CompactSizes;
+	PlainPackets.SetNumUninitialized(NumSamples * PlainSize);
+	CompactPackets.SetNumUninitialized(NumSamples * FBenchmarkEncoder::MaxPacketSize);
+	CompactSizes.SetNumUninitialized(NumSamples);
+
+	// Acks received AckDelayPackets packets after their keyframe, -1 if none
+	TArray<int32> PendingAcks;
+	PendingAcks.Init(-1, AckDelayPackets + 1);
+
+	// Plain layout
+	const uint64 PlainStart = FPlatformTime::Cycles64();
+	for (int32 Index = 0; Index < NumSamples; Index++)
+	{
+		float Values[MotionChannelFloatCount(BenchmarkChannels)];
+		WriteMotionChannels<BenchmarkChannels>(Samples[Index], Values);
+		FMemory::Memcpy(&PlainPackets[Index * PlainSize], Values, PlainSize);
+	}
+	const uint64 PlainCycles = FPlatformTime::Cycles64() - PlainStart;
+
+	// Compact encoding
+	FBenchmarkEncoder Encoder;
+	Encoder.KeyframeInterval = KeyframeInterval;
+	int64 CompactBytes = 0;
+	int32 NumKeyframes = 0;
+	int32 NumFull = 0;
+	const uint64 CompactStart = FPlatformTime::Cycles64();
+	for (int32 Index = 0; Index < NumSamples; Index++)
+	{
+		const int32 AckSlot = Index % PendingAcks.Num();
+		if (PendingAcks[AckSlot] >= 0)
+		{
+			Encoder.Acknowledge(uint8(PendingAcks[AckSlot]));
+			PendingAcks[AckSlot] = -1;
+		}
+
+		uint8* Packet = &CompactPackets[Index * FBenchmarkEncoder::MaxPacketSize];
+		const int32 Size = Encoder.Encode(Samples[Index], Packet, double(Index) / OutputFrequency);
+		CompactSizes[Index] = Size;
+		CompactBytes += Size;
+
+		FMotionWireHeader Header;
+		Header.Read(Packet);
+		if (Header.Type == (uint8)EMotionWirePacket::Keyframe)
+		{
+			PendingAcks[(Index + AckDelayPackets) % PendingAcks.Num()] = Header.KeyframeId;
+			NumKeyframes++;
+		}
+		else if (Header.Type == (uint8)EMotionWirePacket::Full)
+		{
+			NumFull++;
+		}
+	}
+	const uint64 CompactCycles = FPlatformTime::Cycles64() - CompactStart;
+
+	// Decoding
+	FBenchmarkDecoder Decoder;
+	TArray<FMotionData> Decoded;
+	Decoded.SetNum(NumSamples);
+	int32 NumDropped = 0;
+	const uint64 DecodeStart = FPlatformTime::Cycles64();
+	for (int32 Index = 0; Index < NumSamples; Index++)
+	{
+		int32 KeyframeToAck;
+		if (!Decoder.Decode(&CompactPackets[Index * FBenchmarkEncoder::MaxPacketSize], CompactSizes[Index], Decoded[Index], KeyframeToAck))
+		{
+			NumDropped++;
+		}
+	}
+	const uint64 DecodeCycles = FPlatformTime::Cycles64() - DecodeStart;
+
+	// Error in quantization steps, should never exceed 0.5 for values within range
+	float MaxError = 0.0f;
+	for (int32 Index = 0; Index < NumSamples; Index++)
+	{
+		float Expected[MotionChannelFloatCount(BenchmarkChannels)];
+		float Actual[MotionChannelFloatCount(BenchmarkChannels)];
+		WriteMotionChannels<BenchmarkChannels>(Samples[Index], Expected);
+		WriteMotionChannels<BenchmarkChannels>(Decoded[Index], Actual);
+		for (int32 Value = 0; Value < NumFloats; Value++)
+		{
+			MaxError = FMath::Max(MaxError, FMath::Abs(Expected[Value] - Actual[Value]) / Decoder.Quantizer.GetStep(Value));
+		}
+	}
+
+	const double NsPerCycle = FPlatformTime::GetSecondsPerCycle64() * 1.0e9;
+	UE_LOG(LogMotionWireBenchmark, Display, TEXT("%d samples at %d Hz, %d floats per sample"), NumSamples, OutputFrequency, NumFloats);
+	UE_LOG(LogMotionWireBenchmark, Display, TEXT("Plain:   %8.0f bytes/s, encode %6.1f ns/sample"),
+		double(PlainSize) * OutputFrequency, PlainCycles * NsPerCycle / NumSamples);
+	UE_LOG(LogMotionWireBenchmark, Display, TEXT("Compact: %8.0f bytes/s, encode %6.1f ns/sample, decode %6.1f ns/sample"),
+		double(CompactBytes) / NumSamples * OutputFrequency, CompactCycles * NsPerCycle / NumSamples, DecodeCycles * NsPerCycle / NumSamples);
+	UE_LOG(LogMotionWireBenchmark, Display, TEXT("Compact: ack delay %.1f ms (%d packets), %.1f%% keyframes, %.1f%% full, %d dropped, max error %.2f steps"),
+		AckDelay, AckDelayPackets, 100.0f * NumKeyframes / NumSamples, 100.0f * NumFull / NumSamples, NumDropped, MaxError);
+	return 0;
+}
@@ -4,6 +4,48 @@
 
 #include "CoreMinimal.h"
 
+// Groups of FMotionData fields a MotionHost can consume.
+// Every channel is made of 3 floats, in the order they are declared in FMotionData.
+namespace EMotionChannel
+{
+	enum Type : uint32
+	{
+		None					= 0,
+		Rotation				= 1 << 0,	// VehicleRotation
+		Direction				= 1 << 1,	// VehicleDirection
+		Position				= 1 << 2,	// VehiclePosition
+		Kinematic				= 1 << 3,	// VehicleDisplacement, VehicleVelocity, VehicleAcceleration
+		Velocity				= 1 << 4,	// VelocityX, VelocityY, VelocityZ
+		Acceleration			= 1 << 5,	// AccelerationX, AccelerationY, AccelerationZ
+		RotationalDisplacement	= 1 << 6,	// PitchDisplacement, YawDisplacement, RollDisplacement
+		RotationalVelocity		= 1 << 7,	// PitchVelocity, YawVelocity, RollVelocity
+		RotationalAcceleration	= 1 << 8,	// PitchAcceleration, YawAcceleration, RollAcceleration
+		SpecificForce			= 1 << 9,	// SpecificForce at the pilot reference point
+
+		All						= (1 << 10) - 1
+	};
+}
+
+// Channels that must be computed so the requested ones can be derived
+static constexpr uint32 MotionChannelsToCompute(uint32 Channels)
+{
+	return Channels
+		| ((Channels & EMotionChannel::Acceleration) ? EMotionChannel::Velocity : 0)
+		| ((Channels & (EMotionChannel::Direction | EMotionChannel::Kinematic | EMotionChannel::Velocity | EMotionChannel::Acceleration | EMotionChannel::SpecificForce)) ? (EMotionChannel::Position | EMotionChannel::Rotation) : 0)
+		| ((Channels & EMotionChannel::RotationalAcceleration) ? EMotionChannel::RotationalVelocity : 0)
+		| ((Channels & (EMotionChannel::RotationalVelocity | EMotionChannel::RotationalAcceleration)) ? EMotionChannel::RotationalDisplacement : 0)
+		| ((Channels & (EMotionChannel::RotationalDisplacement | EMotionChannel::RotationalVelocity | EMotionChannel::RotationalAcceleration)) ? EMotionChannel::Rotation : 0);
+}
+
+// Number of floats written by WriteMotionChannels()
+static constexpr int32 MotionChannelFloatCount(uint32 Channels)
+{
+	return Channels == 0 ? 0 : int32(Channels & 1) * 3 + MotionChannelFloatCount(Channels >> 1);
+}
+
+// Standard gravity (cm/s2)
+static const float MotionGravity = 980.665f;
+
 // Generic data structure for motion system
 
 struct FMotionData
@@ -38,6 +80,7 @@ struct FMotionData
 		PitchAcceleration = A.PitchAcceleration;
 		YawAcceleration = A.YawAcceleration;
 		RollAcceleration = A.RollAcceleration;
+		SpecificForce = A.SpecificForce;
 		return *this;
 	}
 
@@ -72,6 +115,7 @@ struct FMotionData
 		PitchAcceleration += A.PitchAcceleration;
 		YawAcceleration += A.YawAcceleration;
 		RollAcceleration += A.RollAcceleration;
+		SpecificForce += A.SpecificForce;
 		return *this;
 	}
 
@@ -100,6 +144,7 @@ struct FMotionData
 		PitchAcceleration = PitchAcceleration / num;
 		YawAcceleration = YawAcceleration / num;
 		RollAcceleration = RollAcceleration / num;
+		SpecificForce = SpecificForce / num;
 		return *this;
 	}
 
@@ -128,6 +173,7 @@ struct FMotionData
 		PitchAcceleration = Value;
 		YawAcceleration = Value;
 		RollAcceleration = Value;
+		SpecificForce = FVector(Value, Value, Value);
 	}
 
 	void Reset()
@@ -177,6 +223,9 @@ struct FMotionData
 	float PitchAcceleration;
 	float YawAcceleration;
 	float RollAcceleration;
+
+	// Specific force felt at the pilot reference point, in vehicle space, gravity included (cm/s2)
+	FVector SpecificForce;
 };
 
 // linear interpolation
@@ -213,57 +262,388 @@ static inline float RotationalDifferenceRad(float CurrentAngle, float PreviousAn
 }
 */
 
-// Interpolate from A to B
-static inline FMotionData InterpolateMotionData(FMotionData& A, FMotionData& B, float T)
+// Interpolate from A to B, only the requested channels are written
+template<uint32 Channels>
+static inline FMotionData InterpolateMotionData(const FMotionData& A, const FMotionData& B, float T)
 {
 	FMotionData Out;
 
-	// nlerp 
-	Out.VehicleDirection.X = Lerp(A.VehicleDirection.X, B.VehicleDirection.X, T);
-	Out.VehicleDirection.Y = Lerp(A.VehicleDirection.Y, B.VehicleDirection.Y, T);
-	Out.VehicleDirection.Z = Lerp(A.VehicleDirection.Z, B.VehicleDirection.Z, T);
-	Out.VehicleDirection.Normalize();
+	if (Channels & EMotionChannel::Direction)
+	{
+		// nlerp 
+		Out.VehicleDirection.X = Lerp(A.VehicleDirection.X, B.VehicleDirection.X, T);
+		Out.VehicleDirection.Y = Lerp(A.VehicleDirection.Y, B.VehicleDirection.Y, T);
+		Out.VehicleDirection.Z = Lerp(A.VehicleDirection.Z, B.VehicleDirection.Z, T);
+		Out.VehicleDirection.Normalize();
+	}
+
+	if (Channels & EMotionChannel::Position)
+	{
+		Out.VehiclePosition.X = Lerp(A.VehiclePosition.X, B.VehiclePosition.X, T);
+		Out.VehiclePosition.Y = Lerp(A.VehiclePosition.Y, B.VehiclePosition.Y, T);
+		Out.VehiclePosition.Z = Lerp(A.VehiclePosition.Z, B.VehiclePosition.Z, T);
+	}
 
-	Out.VehiclePosition.X = Lerp(A.VehiclePosition.X, B.VehiclePosition.X, T);
-	Out.VehiclePosition.Y = Lerp(A.VehiclePosition.Y, B.VehiclePosition.Y, T);
-	Out.VehiclePosition.Z = Lerp(A.VehiclePosition.Z, B.VehiclePosition.Z, T);
+	if (Channels & EMotionChannel::Rotation)
+	{
+		float PitchDelta = RotationalDeltaDeg(B.VehicleRotation.Pitch, A.VehicleRotation.Pitch);
+		Out.VehicleRotation.Pitch = RotationalAddDeg(A.VehicleRotation.Pitch, PitchDelta*T);
 
-	float PitchDelta = RotationalDeltaDeg(A.VehicleRotation.Pitch, B.VehicleRotation.Pitch);
-	Out.VehicleRotation.Pitch = RotationalAddDeg(A.VehicleRotation.Pitch, PitchDelta*T);
+		float RollDelta = RotationalDeltaDeg(B.VehicleRotation.Roll, A.VehicleRotation.Roll);
+		Out.VehicleRotation.Roll = RotationalAddDeg(A.VehicleRotation.Roll, RollDelta*T);
 
-	float RollDelta = RotationalDeltaDeg(A.VehicleRotation.Roll, B.VehicleRotation.Roll);
-	Out.VehicleRotation.Roll = RotationalAddDeg(A.VehicleRotation.Roll, RollDelta*T);
+		float YawDelta = RotationalDeltaDeg(B.VehicleRotation.Yaw, A.VehicleRotation.Yaw);
+		Out.VehicleRotation.Yaw = RotationalAddDeg(A.VehicleRotation.Yaw, YawDelta*T);
+	}
 
-	float YawDelta = RotationalDeltaDeg(A.VehicleRotation.Yaw, B.VehicleRotation.Yaw);
-	Out.VehicleRotation.Yaw = RotationalAddDeg(A.VehicleRotation.Yaw, YawDelta*T);
+	if (Channels & EMotionChannel::Velocity)
+	{
+		Out.VelocityX = Lerp(A.VelocityX, B.VelocityX, T);
+		Out.VelocityY = Lerp(A.VelocityY, B.VelocityY, T);
+		Out.VelocityZ = Lerp(A.VelocityZ, B.VelocityZ, T);
+	}
 
-	Out.VelocityX = Lerp(A.VelocityX, B.VelocityX, T);
-	Out.VelocityY = Lerp(A.VelocityY, B.VelocityY, T);
-	Out.VelocityZ = Lerp(A.VelocityZ, B.VelocityZ, T);
+	if (Channels & EMotionChannel::Acceleration)
+	{
+		Out.AccelerationX = Lerp(A.AccelerationX, B.AccelerationX, T);
+		Out.AccelerationY = Lerp(A.AccelerationY, B.AccelerationY, T);
+		Out.AccelerationZ = Lerp(A.AccelerationZ, B.AccelerationZ, T);
+	}
 
-	Out.AccelerationX = Lerp(A.AccelerationX, B.AccelerationX, T);
-	Out.AccelerationY = Lerp(A.AccelerationY, B.AccelerationY, T);
-	Out.AccelerationZ = Lerp(A.AccelerationZ, B.AccelerationZ, T);
+	if (Channels & EMotionChannel::RotationalDisplacement)
+	{
+		Out.PitchDisplacement = Lerp(A.PitchDisplacement, B.PitchDisplacement, T);
+		Out.RollDisplacement = Lerp(A.RollDisplacement, B.RollDisplacement, T);
+		Out.YawDisplacement = Lerp(A.YawDisplacement, B.YawDisplacement, T);
+	}
 
-	Out.PitchDisplacement = Lerp(A.PitchDisplacement, B.PitchDisplacement, T);
-	Out.RollDisplacement = Lerp(A.RollDisplacement, B.RollDisplacement, T);
-	Out.YawDisplacement = Lerp(A.YawDisplacement, B.YawDisplacement, T);
+	if (Channels & EMotionChannel::RotationalVelocity)
+	{
+		Out.PitchVelocity = Lerp(A.PitchVelocity, B.PitchVelocity, T);
+		Out.RollVelocity = Lerp(A.RollVelocity, B.RollVelocity, T);
+		Out.YawVelocity = Lerp(A.YawVelocity, B.YawVelocity, T);
+	}
 
-	Out.PitchVelocity = Lerp(A.PitchVelocity, B.PitchVelocity, T);
-	Out.RollVelocity = Lerp(A.RollVelocity, B.RollVelocity, T);
-	Out.YawVelocity = Lerp(A.YawVelocity, B.YawVelocity, T);
+	if (Channels & EMotionChannel::RotationalAcceleration)
+	{
+		Out.PitchAcceleration = Lerp(A.PitchAcceleration, B.PitchAcceleration, T);
+		Out.RollAcceleration = Lerp(A.RollAcceleration, B.RollAcceleration, T);
+		Out.YawAcceleration = Lerp(A.YawAcceleration, B.YawAcceleration, T);
+	}
 
-	Out.PitchAcceleration = Lerp(A.PitchAcceleration, B.PitchAcceleration, T);
-	Out.RollAcceleration = Lerp(A.RollAcceleration, B.RollAcceleration, T);
-	Out.YawAcceleration = Lerp(A.YawAcceleration, B.YawAcceleration, T);
+	if (Channels & EMotionChannel::Kinematic)
+	{
+		Out.VehicleDisplacement = Lerp(A.VehicleDisplacement, B.VehicleDisplacement, T);
+		Out.VehicleVelocity = Lerp(A.VehicleVelocity, B.VehicleVelocity, T);
+		Out.VehicleAcceleration = Lerp(A.VehicleAcceleration, B.VehicleAcceleration, T);
+	}
 
-	Out.VehicleDisplacement = Lerp(A.VehicleDisplacement, B.VehicleDisplacement, T);
-	Out.VehicleVelocity = Lerp(A.VehicleVelocity, B.VehicleVelocity, T);
-	Out.VehicleAcceleration = Lerp(A.VehicleAcceleration, B.VehicleAcceleration, T);
+	if (Channels & EMotionChannel::SpecificForce)
+	{
+		Out.SpecificForce.X = Lerp(A.SpecificForce.X, B.SpecificForce.X, T);
+		Out.SpecificForce.Y = Lerp(A.SpecificForce.Y, B.SpecificForce.Y, T);
+		Out.SpecificForce.Z = Lerp(A.SpecificForce.Z, B.SpecificForce.Z, T);
+	}
 
 	return Out;
 }
 
+// Interpolate from A to B
+static inline FMotionData InterpolateMotionData(FMotionData& A, FMotionData& B, float T)
+{
+	return InterpolateMotionData<EMotionChannel::All>(A, B, T);
+}
+
+// Same as operator+, but only the requested channels are accumulated
+template<uint32 Channels>
+static inline void AccumulateMotionData(FMotionData& Sum, const FMotionData& A)
+{
+	// Not additive, assigned it
+	Sum.Counter = A.Counter;
+	Sum.MotionStateCommand = A.MotionStateCommand;
+
+	if (Channels & EMotionChannel::Rotation)
+	{
+		Sum.VehicleRotation = A.VehicleRotation;
+	}
+
+	if (Channels & EMotionChannel::Direction)
+	{
+		// keep direction normalized
+		Sum.VehicleDirection += A.VehicleDirection;
+		Sum.VehicleDirection.Normalize();
+	}
+
+	// additive
+	if (Channels & EMotionChannel::Position)
+	{
+		Sum.VehiclePosition += A.VehiclePosition;
+	}
+
+	if (Channels & EMotionChannel::Kinematic)
+	{
+		Sum.VehicleDisplacement += A.VehicleDisplacement;
+		Sum.VehicleVelocity += A.VehicleVelocity;
+		Sum.VehicleAcceleration += A.VehicleAcceleration;
+	}
+
+	if (Channels & EMotionChannel::Velocity)
+	{
+		Sum.VelocityX += A.VelocityX;
+		Sum.VelocityY += A.VelocityY;
+		Sum.VelocityZ += A.VelocityZ;
+	}
+
+	if (Channels & EMotionChannel::Acceleration)
+	{
+		Sum.AccelerationX += A.AccelerationX;
+		Sum.AccelerationY += A.AccelerationY;
+		Sum.AccelerationZ += A.AccelerationZ;
+	}
+
+	if (Channels & EMotionChannel::RotationalDisplacement)
+	{
+		Sum.PitchDisplacement += A.PitchDisplacement;
+		Sum.YawDisplacement += A.YawDisplacement;
+		Sum.RollDisplacement += A.RollDisplacement;
+	}
+
+	if (Channels & EMotionChannel::RotationalVelocity)
+	{
+		Sum.PitchVelocity += A.PitchVelocity;
+		Sum.YawVelocity += A.YawVelocity;
+		Sum.RollVelocity += A.RollVelocity;
+	}
+
+	if (Channels & EMotionChannel::RotationalAcceleration)
+	{
+		Sum.PitchAcceleration += A.PitchAcceleration;
+		Sum.YawAcceleration += A.YawAcceleration;
+		Sum.RollAcceleration += A.RollAcceleration;
+	}
+
+	if (Channels & EMotionChannel::SpecificForce)
+	{
+		Sum.SpecificForce += A.SpecificForce;
+	}
+}
+
+// Same as operator/, but only the requested channels are divided
+template<uint32 Channels>
+static inline void DivideMotionData(FMotionData& Data, float num)
+{
+	if (Channels & EMotionChannel::Position)
+	{
+		Data.VehiclePosition = Data.VehiclePosition / num;
+	}
+
+	if (Channels & EMotionChannel::Kinematic)
+	{
+		Data.VehicleDisplacement = Data.VehicleDisplacement / num;
+		Data.VehicleVelocity = Data.VehicleVelocity / num;
+		Data.VehicleAcceleration = Data.VehicleAcceleration / num;
+	}
+
+	if (Channels & EMotionChannel::Velocity)
+	{
+		Data.VelocityX = Data.VelocityX / num;
+		Data.VelocityY = Data.VelocityY / num;
+		Data.VelocityZ = Data.VelocityZ / num;
+	}
+
+	if (Channels & EMotionChannel::Acceleration)
+	{
+		Data.AccelerationX = Data.AccelerationX / num;
+		Data.AccelerationY = Data.AccelerationY / num;
+		Data.AccelerationZ = Data.AccelerationZ / num;
+	}
+
+	if (Channels & EMotionChannel::RotationalDisplacement)
+	{
+		Data.PitchDisplacement = Data.PitchDisplacement / num;
+		Data.YawDisplacement = Data.YawDisplacement / num;
+		Data.RollDisplacement = Data.RollDisplacement / num;
+	}
+
+	if (Channels & EMotionChannel::RotationalVelocity)
+	{
+		Data.PitchVelocity = Data.PitchVelocity / num;
+		Data.YawVelocity = Data.YawVelocity / num;
+		Data.RollVelocity = Data.RollVelocity / num;
+	}
+
+	if (Channels & EMotionChannel::RotationalAcceleration)
+	{
+		Data.PitchAcceleration = Data.PitchAcceleration / num;
+		Data.YawAcceleration = Data.YawAcceleration / num;
+		Data.RollAcceleration = Data.RollAcceleration / num;
+	}
+
+	if (Channels & EMotionChannel::SpecificForce)
+	{
+		Data.SpecificForce = Data.SpecificForce / num;
+	}
+}
+
+// Pack the requested channels in a flat float array, in the order of EMotionChannel
+// Out must hold at least MotionChannelFloatCount(Channels) floats, returns the number of floats written
+template<uint32 Channels>
+static inline int32 WriteMotionChannels(const FMotionData& Data, float* Out)
+{
+	float* Start = Out;
+
+	if (Channels & EMotionChannel::Rotation)
+	{
+		*Out++ = Data.VehicleRotation.Roll;
+		*Out++ = Data.VehicleRotation.Pitch;
+		*Out++ = Data.VehicleRotation.Yaw;
+	}
+
+	if (Channels & EMotionChannel::Direction)
+	{
+		*Out++ = Data.VehicleDirection.X;
+		*Out++ = Data.VehicleDirection.Y;
+		*Out++ = Data.VehicleDirection.Z;
+	}
+
+	if (Channels & EMotionChannel::Position)
+	{
+		*Out++ = Data.VehiclePosition.X;
+		*Out++ = Data.VehiclePosition.Y;
+		*Out++ = Data.VehiclePosition.Z;
+	}
+
+	if (Channels & EMotionChannel::Kinematic)
+	{
+		*Out++ = Data.VehicleDisplacement;
+		*Out++ = Data.VehicleVelocity;
+		*Out++ = Data.VehicleAcceleration;
+	}
+
+	if (Channels & EMotionChannel::Velocity)
+	{
+		*Out++ = Data.VelocityX;
+		*Out++ = Data.VelocityY;
+		*Out++ = Data.VelocityZ;
+	}
+
+	if (Channels & EMotionChannel::Acceleration)
+	{
+		*Out++ = Data.AccelerationX;
+		*Out++ = Data.AccelerationY;
+		*Out++ = Data.AccelerationZ;
+	}
+
+	if (Channels & EMotionChannel::RotationalDisplacement)
+	{
+		*Out++ = Data.PitchDisplacement;
+		*Out++ = Data.YawDisplacement;
+		*Out++ = Data.RollDisplacement;
+	}
+
+	if (Channels & EMotionChannel::RotationalVelocity)
+	{
+		*Out++ = Data.PitchVelocity;
+		*Out++ = Data.YawVelocity;
+		*Out++ = Data.RollVelocity;
+	}
+
+	if (Channels & EMotionChannel::RotationalAcceleration)
+	{
+		*Out++ = Data.PitchAcceleration;
+		*Out++ = Data.YawAcceleration;
+		*Out++ = Data.RollAcceleration;
+	}
+
+	if (Channels & EMotionChannel::SpecificForce)
+	{
+		*Out++ = Data.SpecificForce.X;
+		*Out++ = Data.SpecificForce.Y;
+		*Out++ = Data.SpecificForce.Z;
+	}
+
+	return int32(Out - Start);
+}
+
+// Inverse of WriteMotionChannels(), returns the number of floats read
+template<uint32 Channels>
+static inline int32 ReadMotionChannels(FMotionData& Data, const float* In)
+{
+	const float* Start = In;
+
+	if (Channels & EMotionChannel::Rotation)
+	{
+		Data.VehicleRotation.Roll = *In++;
+		Data.VehicleRotation.Pitch = *In++;
+		Data.VehicleRotation.Yaw = *In++;
+	}
+
+	if (Channels & EMotionChannel::Direction)
+	{
+		Data.VehicleDirection.X = *In++;
+		Data.VehicleDirection.Y = *In++;
+		Data.VehicleDirection.Z = *In++;
+	}
+
+	if (Channels & EMotionChannel::Position)
+	{
+		Data.VehiclePosition.X = *In++;
+		Data.VehiclePosition.Y = *In++;
+		Data.VehiclePosition.Z = *In++;
+	}
+
+	if (Channels & EMotionChannel::Kinematic)
+	{
+		Data.VehicleDisplacement = *In++;
+		Data.VehicleVelocity = *In++;
+		Data.VehicleAcceleration = *In++;
+	}
+
+	if (Channels & EMotionChannel::Velocity)
+	{
+		Data.VelocityX = *In++;
+		Data.VelocityY = *In++;
+		Data.VelocityZ = *In++;
+	}
+
+	if (Channels & EMotionChannel::Acceleration)
+	{
+		Data.AccelerationX = *In++;
+		Data.AccelerationY = *In++;
+		Data.AccelerationZ = *In++;
+	}
+
+	if (Channels & EMotionChannel::RotationalDisplacement)
+	{
+		Data.PitchDisplacement = *In++;
+		Data.YawDisplacement = *In++;
+		Data.RollDisplacement = *In++;
+	}
+
+	if (Channels & EMotionChannel::RotationalVelocity)
+	{
+		Data.PitchVelocity = *In++;
+		Data.YawVelocity = *In++;
+		Data.RollVelocity = *In++;
+	}
+
+	if (Channels & EMotionChannel::RotationalAcceleration)
+	{
+		Data.PitchAcceleration = *In++;
+		Data.YawAcceleration = *In++;
+		Data.RollAcceleration = *In++;
+	}
+
+	if (Channels & EMotionChannel::SpecificForce)
+	{
+		Data.SpecificForce.X = *In++;
+		Data.SpecificForce.Y = *In++;
+		Data.SpecificForce.Z = *In++;
+	}
+
+	return int32(In - Start);
+}
+
 static inline FString GetFloatAsStringWithPrecision(float TheFloat, int32 Precision, bool IncludeLeadingZero = true)
 {
 	//Round to integral if have something like 1.9999 within precision
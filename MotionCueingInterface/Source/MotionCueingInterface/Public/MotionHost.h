@@ -3,10 +3,27 @@
 #pragma once
 
 #include "MotionData.h"
+#include "MotionPipeline.h"
 #include "CoreMinimal.h"
 #include "Engine.h"
 
+// Controller state reported back to the host, used to adapt the output rate
+struct FMotionFeedback
+{
+	// Time between sending a frame and receiving its ack (s), negative if unknown
+	float RoundTripTime = -1.0f;
+
+	// Frames received by the controller and not processed yet, negative if unknown
+	int32 QueueDepth = -1;
+};
+
 // Generic base class to interface with external Motion System API
+// Threading: Initialize(), ConnectToController() and Cleanup() are called from the thread owning the runtime
+// (the game thread for UMotionProbe). The per tick functions, ReceiveDataFromController(), SetStateFlow(),
+// SendDataToController() and GetFeedback(), are called from the thread ticking the runtime: the game thread
+// by default, or the time critical MotionRuntime thread with UMotionProbe::UseOutputThread and the commandlet.
+// That thread sleeps then yields for the last millisecond before each tick, so a host used there
+// must not touch UObjects and must not block.
 class MotionHost
 {
 private:
@@ -16,6 +33,12 @@ private:
 
 public:
 
+	virtual ~MotionHost() {}
+
+	// Channels of FMotionData consumed by the host, known at compile time.
+	// Derived hosts hide this with their own value so that only those channels are computed, interpolated and sent.
+	static const uint32 Channels = EMotionChannel::All;
+
 	// Init API
 	virtual void Initialize() = 0;
 
@@ -33,4 +56,11 @@ public:
 
 	// Sequence of command to control state machine
 	virtual void SetStateFlow() = 0;
+
+	// Latest feedback read in ReceiveDataFromController(), returns false if the controller doesn't report any
+	virtual bool GetFeedback(FMotionFeedback& Feedback) { return false; }
+
+	// Sample points of the latest sample, called before SendDataToController() when the probe has some.
+	// Not averaged nor interpolated, they change at the sampling rate.
+	virtual void SetSamplePoints(const FMotionPointData* Points, int32 NumPoints) {}
 };
@@ -0,0 +1,46 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Counters of the output side of the motion loop
+struct FMotionMetrics
+{
+	FMotionMetrics()
+	{
+		Reset();
+	}
+
+	void Reset()
+	{
+		FramesSent = 0;
+		AveragesReceived = 0;
+		LateTicks = 0;
+		DeadlineMisses = 0;
+		Washouts = 0;
+		Recoveries = 0;
+		RateChanges = 0;
+	}
+
+	// Frames sent to the controller
+	uint32 FramesSent;
+
+	// Averages produced by the pipeline
+	uint32 AveragesReceived;
+
+	// Controller ticks skipped because the output thread was late, or collapsed from a timer burst
+	uint32 LateTicks;
+
+	// Watchdog: newest sample older than the deadline, switched to extrapolation
+	uint32 DeadlineMisses;
+
+	// Watchdog: extrapolation expired, washing back to neutral
+	uint32 Washouts;
+
+	// Watchdog: fresh data after a deadline miss, blending back to live data
+	uint32 Recoveries;
+
+	// Rate controller: output rate raised or lowered
+	uint32 RateChanges;
+};
@@ -0,0 +1,431 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformTime.h"
+#include "MotionData.h"
+
+// Sampling -> averaging -> interpolation, without any dependency on a world or an actor.
+// Used by UMotionProbe and by the headless FMotionRuntime.
+
+// The low frequency function is AddPose()
+// The high frequency function is NextOutput()
+// We interpolate between PreviousAverageHostData and CurrentAverageHostData
+// Only the channels consumed by the host are averaged and interpolated.
+// ComputedChannels adds the ones they are derived from (e.g. Acceleration needs Velocity).
+// The vehicle inverse rotation, angular velocity and angular acceleration are computed once per sample,
+// then shared by the pilot reference point and every sample point.
+// The caller reads each point at its own rate (FMotionPose::UpdatedPoints), the offset of the others is kept.
+
+// Maximum number of extra points sampled with the vehicle (seat, head, cargo...)
+static const int32 MaxMotionSamplePoints = 4;
+
+// Pose of the vehicle fed to the pipeline
+struct FMotionPose
+{
+	FVector Position;
+	FRotator Rotation;
+
+	// Time since the previous pose (s)
+	float DeltaTime;
+
+	// World position of the sample points, only the ones whose bit is set in UpdatedPoints were read for this pose
+	int32 NumPoints = 0;
+	uint32 UpdatedPoints = 0;
+	FVector PointPositions[MaxMotionSamplePoints];
+};
+
+// Motion of a sample point, in vehicle space. Points are treated as rigidly attached at their last read offset.
+struct FMotionPointData
+{
+	// From the vehicle origin (cm)
+	FVector Offset = FVector::ZeroVector;
+
+	// Gravity included (cm/s2)
+	FVector SpecificForce = FVector(0.0f, 0.0f, MotionGravity);
+};
+
+template<uint32 Channels>
+class TMotionPipeline
+{
+public:
+
+	static const uint32 HostChannels = Channels;
+	static const uint32 ComputedChannels = MotionChannelsToCompute(Channels);
+	static const int32 PackedFloatCount = MotionChannelFloatCount(Channels);
+
+	TMotionPipeline()
+	{
+		SampleInterval = 0.033f;	// 30Hz
+		AverageCount = 10;
+		OutputFrequency = 100;
+		MaxSampleGap = 0.1f;
+		PilotOffset = FVector::ZeroVector;
+		Reset();
+	}
+
+	void Reset()
+	{
+		NextTickDT = 0.0f;
+		TickControllerTotal = 0;
+		TickControllerCounter = 0;
+		TickControllerCount = 0;
+		Buffer.Reset();
+		NumBufferedSamples = 0;
+		CurrentHostData.Reset();
+		PreviousHostData.Reset();
+		CurrentAverageHostData.Reset();
+		PreviousAverageHostData.Reset();
+
+		// Neutral specific force is 1 g up, zero would be a free fall cue before the first average
+		CurrentAverageHostData.SpecificForce = FVector(0.0f, 0.0f, MotionGravity);
+		PreviousAverageHostData.SpecificForce = CurrentAverageHostData.SpecificForce;
+		LastAverageTime = FPlatformTime::Seconds();
+		LastSampleTime = LastAverageTime;
+
+		bHasFrame = false;
+		bHasRigidBodyVelocity = false;
+		CurrentPosition = FVector::ZeroVector;
+		PreviousPosition = FVector::ZeroVector;
+		CurrentRotation = FQuat::Identity;
+		InverseRotation = FQuat::Identity;
+		PreviousInverseRotation = FQuat::Identity;
+		PreviousWorldVelocity = FVector::ZeroVector;
+		AngularVelocity = FVector::ZeroVector;
+		AngularAcceleration = FVector::ZeroVector;
+		OriginSpecificForce = FVector::ZeroVector;
+		NumPoints = 0;
+		for (FMotionPointData& Point : Points)
+		{
+			Point = FMotionPointData();
+		}
+	}
+
+	// Feed the pose of the vehicle only
+	bool AddPose(const FVector& Position, const FRotator& Rotation, float DeltaTime)
+	{
+		FMotionPose Pose;
+		Pose.Position = Position;
+		Pose.Rotation = Rotation;
+		Pose.DeltaTime = DeltaTime;
+		return AddPose(Pose);
+	}
+
+	// Feed the pose of the vehicle and its sample points, DeltaTime seconds after the previous one
+	// Returns true if a new average is ready to be interpolated
+	bool AddPose(const FMotionPose& Pose)
+	{
+		const FVector& Position = Pose.Position;
+		const FRotator& Rotation = Pose.Rotation;
+		NextTickDT += Pose.DeltaTime;
+		if (NextTickDT > SampleInterval)
+		{
+			// How many times we tick the controller in that frame, a hitch doesn't stretch the segment
+			TickControllerCounter += FMath::FloorToInt(FMath::Min(NextTickDT, MaxSampleGap) * OutputFrequency);
+			LastSampleTime = FPlatformTime::Seconds();
+
+			// Save previous data since we interpolate between "previous" and "current"
+			PreviousHostData = CurrentHostData;
+
+			// Get current data
+			if (ComputedChannels & EMotionChannel::Position)
+			{
+				CurrentHostData.VehiclePosition = Position;
+			}
+			if (ComputedChannels & EMotionChannel::Rotation)
+			{
+				CurrentHostData.VehicleRotation = Rotation;
+			}
+
+			// Vehicle reference frame, computed once for this sample, the first one also seeds the previous frame
+			const bool bHasPreviousFrame = bHasFrame;
+			PreviousPosition = bHasPreviousFrame ? CurrentPosition : Position;
+			CurrentPosition = Position;
+			CurrentRotation = Rotation.Quaternion();
+			PreviousInverseRotation = bHasPreviousFrame ? InverseRotation : CurrentRotation.Inverse();
+			InverseRotation = CurrentRotation.Inverse();
+			bHasFrame = true;
+
+			Differentiate(NextTickDT);
+
+			// Rigid body motion, for the pilot reference point and the sample points
+			if ((ComputedChannels & EMotionChannel::SpecificForce) || Pose.NumPoints > 0)
+			{
+				UpdateRigidBody(NextTickDT, bHasPreviousFrame);
+				if (ComputedChannels & EMotionChannel::SpecificForce)
+				{
+					CurrentHostData.SpecificForce = GetSpecificForceAt(PilotOffset);
+				}
+				UpdatePointOffsets(Pose, InverseRotation);
+				UpdatePoints();
+			}
+			else
+			{
+				// Velocities of this sample are missing, the next one can't differentiate them
+				bHasRigidBodyVelocity = false;
+			}
+
+			// reset
+			NextTickDT = 0.0f;
+
+			// accumulate the host channels in buffer to average over time
+			const int32 Offset = Buffer.AddUninitialized(PackedFloatCount);
+			WriteMotionChannels<Channels>(CurrentHostData, Buffer.GetData() + Offset);
+			NumBufferedSamples++;
+		}
+		else if (Pose.UpdatedPoints != 0)
+		{
+			// Not sampled, keep the points read in that pose for the next sample
+			UpdatePointOffsets(Pose, Rotation.Quaternion().Inverse());
+		}
+
+		// average over time
+		if (NumBufferedSamples >= AverageCount)
+		{
+			TickControllerTotal = TickControllerCounter;
+			TickControllerCounter = 0;
+			TickControllerCount = 0;
+			PreviousAverageHostData = CurrentAverageHostData;
+			CurrentAverageHostData.Reset();
+			FMotionData Sample;
+			for (int32 Index = 0; Index < NumBufferedSamples; Index++)
+			{
+				ReadMotionChannels<Channels>(Sample, Buffer.GetData() + Index * PackedFloatCount);
+				AccumulateMotionData<Channels>(CurrentAverageHostData, Sample);
+			}
+			DivideMotionData<Channels>(CurrentAverageHostData, NumBufferedSamples);
+			Buffer.Reset();
+			NumBufferedSamples = 0;
+			LastAverageTime = FPlatformTime::Seconds();
+			return true;
+		}
+
+		return false;
+	}
+
+	// Interpolated data for the next controller tick
+	FMotionData NextOutput()
+	{
+		float T = float(TickControllerCount) / float(TickControllerTotal - 1);
+		T = FMath::Clamp(T, 0.0f, 1.0f);
+		TickControllerCount++;
+		return InterpolateMotionData<Channels>(PreviousAverageHostData, CurrentAverageHostData, T);
+	}
+
+	// Change the controller rate without restarting, the current segment is rescaled so T keeps going at the same speed
+	void SetOutputFrequency(int Frequency)
+	{
+		if (Frequency == OutputFrequency || Frequency <= 0)
+		{
+			return;
+		}
+		const float Ratio = float(Frequency) / float(OutputFrequency);
+		TickControllerCount = FMath::RoundToInt(TickControllerCount * Ratio);
+		TickControllerTotal = FMath::RoundToInt(TickControllerTotal * Ratio);
+		TickControllerCounter = FMath::RoundToInt(TickControllerCounter * Ratio);
+		OutputFrequency = Frequency;
+	}
+
+	// Data along the current segment without advancing the controller tick, T > 1 extrapolates past the current average
+	FMotionData Extrapolate(float T) const
+	{
+		return InterpolateMotionData<Channels>(PreviousAverageHostData, CurrentAverageHostData, T);
+	}
+
+	// Increment of T per controller tick
+	float GetTickStep() const { return 1.0f / float(FMath::Max(TickControllerTotal - 1, 1)); }
+
+	// T of the next controller tick along the current segment
+	float GetNextT() const { return FMath::Clamp(float(TickControllerCount) * GetTickStep(), 0.0f, 1.0f); }
+
+	// Time (FPlatformTime::Seconds) of the newest sample, and of the newest average
+	double GetLastSampleTime() const { return LastSampleTime; }
+	double GetLastAverageTime() const { return LastAverageTime; }
+
+	// Specific force at an offset from the vehicle origin, in vehicle space: a + alpha x r + w x (w x r)
+	FVector GetSpecificForceAt(const FVector& Offset) const
+	{
+		return OriginSpecificForce
+			+ FVector::CrossProduct(AngularAcceleration, Offset)
+			+ FVector::CrossProduct(AngularVelocity, FVector::CrossProduct(AngularVelocity, Offset));
+	}
+
+	int32 GetNumPoints() const { return NumPoints; }
+	const FMotionPointData& GetPointData(int32 Index) const { return Points[Index]; }
+
+	const FMotionData& GetCurrentAverage() const { return CurrentAverageHostData; }
+	int GetTickCount() const { return TickControllerCount; }
+	int GetTickTotal() const { return TickControllerTotal; }
+
+	// Time between two samples (s)
+	float SampleInterval;
+
+	// Number of samples averaged together
+	int AverageCount;
+
+	// Controller ticks per second
+	int OutputFrequency;
+
+	// Longest time between two samples counted in a segment (s), longer gaps are hitches
+	float MaxSampleGap;
+
+	// Pilot reference point in vehicle space (cm), where SpecificForce is computed
+	FVector PilotOffset;
+
+private:
+
+	// Derive velocities and accelerations from the previous sample
+	void Differentiate(float DT)
+	{
+		if (ComputedChannels & (EMotionChannel::Direction | EMotionChannel::Kinematic | EMotionChannel::Velocity))
+		{
+			// Calculate forward vector in vehicle space
+			FVector ForwardVector = CurrentHostData.VehiclePosition - PreviousHostData.VehiclePosition;
+			ForwardVector = InverseRotation.RotateVector(ForwardVector);
+
+			// Vehicle Direction and Displacement
+			ForwardVector.ToDirectionAndLength(CurrentHostData.VehicleDirection, CurrentHostData.VehicleDisplacement);
+
+			if (ComputedChannels & EMotionChannel::Kinematic)
+			{
+				// Vehicle Velocity
+				CurrentHostData.VehicleVelocity = CurrentHostData.VehicleDisplacement / DT;
+
+				// Vehicle Acceleration
+				CurrentHostData.VehicleAcceleration = (CurrentHostData.VehicleVelocity - PreviousHostData.VehicleVelocity) / DT;
+			}
+
+			// Kinematic velocity and acceleration per axis
+			if (ComputedChannels & EMotionChannel::Velocity)
+			{
+				CurrentHostData.VelocityX = (ForwardVector.X) / DT;	// forward speed
+				CurrentHostData.VelocityY = (ForwardVector.Y) / DT;	// side speed
+				CurrentHostData.VelocityZ = (ForwardVector.Z) / DT;	// up speed
+			}
+			if (ComputedChannels & EMotionChannel::Acceleration)
+			{
+				CurrentHostData.AccelerationX = (CurrentHostData.VelocityX - PreviousHostData.VelocityX) / DT;	// forward acceleration
+				CurrentHostData.AccelerationY = (CurrentHostData.VelocityY - PreviousHostData.VelocityY) / DT;	// side acceleration
+				CurrentHostData.AccelerationZ = (CurrentHostData.VelocityZ - PreviousHostData.VelocityZ) / DT;	// up acceleration
+			}
+		}
+
+		// Rotational motion
+		if (ComputedChannels & EMotionChannel::RotationalDisplacement)
+		{
+			CurrentHostData.PitchDisplacement = RotationalDeltaDeg(CurrentHostData.VehicleRotation.Pitch, PreviousHostData.VehicleRotation.Pitch);
+			CurrentHostData.RollDisplacement = RotationalDeltaDeg(CurrentHostData.VehicleRotation.Roll, PreviousHostData.VehicleRotation.Roll);
+			CurrentHostData.YawDisplacement = RotationalDeltaDeg(CurrentHostData.VehicleRotation.Yaw, PreviousHostData.VehicleRotation.Yaw);
+		}
+
+		if (ComputedChannels & EMotionChannel::RotationalVelocity)
+		{
+			CurrentHostData.PitchVelocity = CurrentHostData.PitchDisplacement / DT;
+			CurrentHostData.RollVelocity = CurrentHostData.RollDisplacement / DT;
+			CurrentHostData.YawVelocity = CurrentHostData.YawDisplacement / DT;
+		}
+
+		if (ComputedChannels & EMotionChannel::RotationalAcceleration)
+		{
+			CurrentHostData.PitchAcceleration = (CurrentHostData.PitchVelocity - PreviousHostData.PitchVelocity) / DT;
+			CurrentHostData.RollAcceleration = (CurrentHostData.RollVelocity - PreviousHostData.RollVelocity) / DT;
+			CurrentHostData.YawAcceleration = (CurrentHostData.YawVelocity - PreviousHostData.YawVelocity) / DT;
+		}
+	}
+
+	// Linear and angular motion of the vehicle, in vehicle space.
+	// Velocities need the previous frame and accelerations the previous velocities, until then they are zero:
+	// differentiating from the reset pose would send the absolute pose of the vehicle as motion.
+	void UpdateRigidBody(float DT, bool bHasPreviousFrame)
+	{
+		const bool bHasAcceleration = bHasPreviousFrame && bHasRigidBodyVelocity;
+
+		// Acceleration of the vehicle origin, minus gravity
+		const FVector WorldVelocity = bHasPreviousFrame ? (CurrentPosition - PreviousPosition) / DT : FVector::ZeroVector;
+		const FVector WorldAcceleration = bHasAcceleration ? (WorldVelocity - PreviousWorldVelocity) / DT : FVector::ZeroVector;
+		PreviousWorldVelocity = WorldVelocity;
+		OriginSpecificForce = InverseRotation.RotateVector(WorldAcceleration + FVector(0.0f, 0.0f, MotionGravity));
+
+		// Rotation between the two samples, in vehicle space, shortest path
+		FQuat DeltaRotation = PreviousInverseRotation * CurrentRotation;
+		if (DeltaRotation.W < 0.0f)
+		{
+			DeltaRotation = DeltaRotation * -1.0f;
+		}
+
+		// Angular velocity (rad/s) and acceleration (rad/s2)
+		FVector Axis;
+		float Angle;
+		DeltaRotation.ToAxisAndAngle(Axis, Angle);
+		const FVector NewAngularVelocity = bHasPreviousFrame ? Axis * (Angle / DT) : FVector::ZeroVector;
+		AngularAcceleration = bHasAcceleration ? (NewAngularVelocity - AngularVelocity) / DT : FVector::ZeroVector;
+		AngularVelocity = NewAngularVelocity;
+		bHasRigidBodyVelocity = bHasPreviousFrame;
+	}
+
+	// Offset of the points read in a pose, in the vehicle frame of that pose
+	void UpdatePointOffsets(const FMotionPose& Pose, const FQuat& PoseInverseRotation)
+	{
+		NumPoints = FMath::Min(Pose.NumPoints, MaxMotionSamplePoints);
+		for (int32 Index = 0; Index < NumPoints; Index++)
+		{
+			if (Pose.UpdatedPoints & (1u << Index))
+			{
+				Points[Index].Offset = PoseInverseRotation.RotateVector(Pose.PointPositions[Index] - Pose.Position);
+			}
+		}
+	}
+
+	// Specific force of every sample point for this sample, from its last read offset
+	void UpdatePoints()
+	{
+		for (int32 Index = 0; Index < NumPoints; Index++)
+		{
+			Points[Index].SpecificForce = GetSpecificForceAt(Points[Index].Offset);
+		}
+	}
+
+	// Low frequency counter
+	float NextTickDT;
+
+	// Motion data per sample
+	FMotionData CurrentHostData;
+	FMotionData PreviousHostData;
+
+	// Samples to average, only the host channels, packed by WriteMotionChannels()
+	TArray<float> Buffer;
+	int32 NumBufferedSamples;
+
+	// Average Motion data over time, only the host channels are set
+	FMotionData CurrentAverageHostData;
+	FMotionData PreviousAverageHostData;
+
+	// High frequency counters
+	int TickControllerCount;
+	int TickControllerTotal;
+	int TickControllerCounter;
+
+	// Arrival of samples and averages
+	double LastSampleTime;
+	double LastAverageTime;
+
+	// Vehicle reference frame of the current and previous samples
+	bool bHasFrame;
+	FVector CurrentPosition;
+	FVector PreviousPosition;
+	FQuat CurrentRotation;
+	FQuat InverseRotation;
+	FQuat PreviousInverseRotation;
+
+	// Rigid body motion, in vehicle space, bHasRigidBodyVelocity if the velocities of the previous sample are valid
+	bool bHasRigidBodyVelocity;
+	FVector PreviousWorldVelocity;
+	FVector AngularVelocity;
+	FVector AngularAcceleration;
+	FVector OriginSpecificForce;
+
+	// Sample points
+	int32 NumPoints;
+	FMotionPointData Points[MaxMotionSamplePoints];
+};
@@ -8,7 +8,7 @@
 #include "Components/SkeletalMeshComponent.h"
 #include "Engine.h"
 #include "MotionData.h"
-#include "MyMotionHost.h"
+#include "MotionRuntime.h"
 #include "MotionProbe.generated.h"
 
 
@@ -59,32 +59,28 @@ protected:
 	virtual void EndPlay(const EEndPlayReason::Type) override;
 	void DebugPrint(float Deltatime);
 
-	// Low frequency counters
+	// Low frequency interval
 	float NextTickTime;
-	float NextTickDT;
 
-	// Motion data per frame
-	FMotionData CurrentHostData;
-	FMotionData PreviousHostData;
+	// Poses of the BaseObject, from the game thread to the runtime
+	FMotionPoseQueue PoseQueue;
 
-	// Average Motion data over time
-	TArray<FMotionData> Buffer;
-	FMotionData CurrentAverageHostData;
-	FMotionData PreviousAverageHostData;
+	// Sampling, averaging, interpolation and Host Interface
+	TUniquePtr<FMotionRuntime> Runtime;
 
 	// Object used to get data from
 	UMeshComponent* BaseObject;
 
-	// High frequency timer and counters
-	int TickControllerCount;
-	int TickControllerTotal;
-	int TickControllerCounter;
-	int TickControllerAverageCount;
+	// Extra points sampled with the BaseObject, and how many frames between two reads of each
+	UPROPERTY()
+		TArray<USceneComponent*> SamplePoints;
+	TArray<int32> SamplePointRateDivisors;
+	uint32 PoseIndex;
+
+	// High frequency timer, when not using the output thread
 	FTimerHandle TimerHandle;
 	FTimerDelegate TimerDel;
-
-	// Host Interface
-	MotionHost* HostInterface = new MyMotionHost();
+	int TimerFrequency;
 
 public:	
 
@@ -103,6 +99,16 @@ public:
 	UPROPERTY(EditAnywhere)
 		int OutputFrequency;
 
+	// Raise or lower the output rate at runtime from send timing and controller feedback
+	UPROPERTY(EditAnywhere, Category = "Rate Control")
+		bool UseAdaptiveRate;
+
+	UPROPERTY(EditAnywhere, Category = "Rate Control")
+		int MinOutputFrequency;
+
+	UPROPERTY(EditAnywhere, Category = "Rate Control")
+		int MaxOutputFrequency;
+
 	UPROPERTY(EditAnywhere)
 		FString ControllerIP;
 
@@ -115,10 +121,44 @@ public:
 	UPROPERTY(EditAnywhere)
 		bool UseDebugMode;
 
+	// Send to the controller from a dedicated thread, keeps a steady rate when the game thread hitches
+	// The host is then ticked from that thread, see the threading notes on MotionHost
+	UPROPERTY(EditAnywhere)
+		bool UseOutputThread;
+
+	// Time the newest data can be late before extrapolating (s)
+	UPROPERTY(EditAnywhere, Category = "Watchdog")
+		float WatchdogDeadline;
+
+	// Time spent extrapolating before washing back to neutral (s)
+	UPROPERTY(EditAnywhere, Category = "Watchdog")
+		float ExtrapolationTime;
+
+	// Time to ease in and out of the per channel washout rate limits (s)
+	UPROPERTY(EditAnywhere, Category = "Watchdog")
+		float WashoutEaseTime;
+
+	// Time to blend back to live data once fresh data arrives (s)
+	UPROPERTY(EditAnywhere, Category = "Watchdog")
+		float RecoveryTime;
+
+	// Pilot reference point relative to the BaseObject, in vehicle space (cm), where the specific force is computed
+	UPROPERTY(EditAnywhere)
+		FVector PilotOffset;
+
 	// Blueprint Function to set the base object
 	UFUNCTION(BlueprintCallable, Category = "MotionCueing")
 		void SetBaseObject(UMeshComponent* Input);
 
+	// Blueprint Function to sample an extra point (seat, head, cargo...) every RateDivisor frames, returns its index
+	// Its specific force is forwarded to the host with MotionHost::SetSamplePoints()
+	UFUNCTION(BlueprintCallable, Category = "MotionCueing")
+		int32 AddSamplePoint(USceneComponent* Point, int32 RateDivisor = 1);
+
+	// Specific force at a sample point for the latest sample, in vehicle space, gravity included (cm/s2)
+	UFUNCTION(BlueprintCallable, Category = "MotionCueing")
+		FVector GetSamplePointSpecificForce(int32 Index) const;
+
 	// High frequency function that sends data to controller
 	UFUNCTION()
 		void TickController();
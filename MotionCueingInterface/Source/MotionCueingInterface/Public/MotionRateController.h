@@ -0,0 +1,87 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MotionHost.h"
+
+// Why the output rate last changed
+enum class EMotionRateReason : uint8
+{
+	None,
+	ControllerQueue,	// controller queue is growing
+	RoundTrip,			// acks come back too late
+	SendJitter,			// ticks are not sent at a steady interval
+	HostOverload,		// sending takes too much of the period
+	Headroom			// everything was healthy, rate raised
+};
+
+static inline const TCHAR* GetMotionRateReasonName(EMotionRateReason Reason)
+{
+	switch (Reason)
+	{
+	case EMotionRateReason::ControllerQueue:	return TEXT("ControllerQueue");
+	case EMotionRateReason::RoundTrip:			return TEXT("RoundTrip");
+	case EMotionRateReason::SendJitter:			return TEXT("SendJitter");
+	case EMotionRateReason::HostOverload:		return TEXT("HostOverload");
+	case EMotionRateReason::Headroom:			return TEXT("Headroom");
+	default:									return TEXT("None");
+	}
+}
+
+// Closed loop control of the output rate, within [MinFrequency, MaxFrequency]
+// Measurements are gathered every tick and evaluated every EvaluationInterval:
+// the rate is lowered by DecreaseFactor as soon as one limit is exceeded,
+// and raised by IncreaseStep after HealthyEvaluations healthy evaluations in a row.
+// The rate is only raised above the one given to Reset() when the controller reports feedback within the limits.
+class FMotionRateController
+{
+public:
+
+	FMotionRateController();
+
+	// Start from Frequency, clamped to the bounds, it is also the highest rate without controller feedback
+	void Reset(int Frequency);
+
+	// Measurements of one tick. Returns true if the rate changed.
+	// SendInterval: time since the previous tick (s), negative when the caller doesn't schedule the ticks
+	// (e.g. world timer bursts), the jitter is then not checked. SendDuration: time spent in the host (s)
+	bool Update(double Now, float SendInterval, float SendDuration, const FMotionFeedback* Feedback);
+
+	int GetFrequency() const { return Frequency; }
+	EMotionRateReason GetReason() const { return Reason; }
+
+	// Bounds of the output rate (Hz)
+	int MinFrequency;
+	int MaxFrequency;
+
+	// Limits, a negative value disables the check
+	float MaxJitter;			// mean deviation of the send interval from the period, fraction of the period
+	float MaxSendLoad;			// fraction of the period spent sending
+	float MaxRoundTripTime;		// (s)
+	int32 MaxQueueDepth;		// frames
+
+	// Control
+	float EvaluationInterval;	// (s)
+	float DecreaseFactor;
+	int IncreaseStep;			// (Hz)
+	int HealthyEvaluations;
+
+private:
+
+	// Clear the measurements of the current window
+	void ResetWindow(double Now);
+
+	int Frequency;
+	int NominalFrequency;
+	EMotionRateReason Reason;
+	int HealthyCount;
+
+	// Current window
+	double WindowStart;
+	int32 NumJitterTicks;
+	float JitterSum;
+	float MaxSendDuration;
+	float MaxRoundTrip;
+	int32 MaxQueue;
+};
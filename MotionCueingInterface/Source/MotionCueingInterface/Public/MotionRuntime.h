@@ -0,0 +1,179 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/ThreadSafeBool.h"
+#include "Containers/Queue.h"
+#include "Misc/ScopeLock.h"
+#include "MotionMetrics.h"
+#include "MotionRateController.h"
+#include "MotionWatchdog.h"
+#include "MyMotionHost.h"
+
+class FSocket;
+
+// Source of vehicle poses, polled from the runtime thread
+class IMotionPoseSource
+{
+public:
+
+	virtual ~IMotionPoseSource() {}
+
+	// Returns true and fills Pose for every pose available at time Now (s)
+	virtual bool Poll(double Now, FMotionPose& Pose) = 0;
+
+	// True once no more poses will come
+	virtual bool IsFinished() const { return false; }
+};
+
+// Poses pushed by one producer thread (e.g. the game thread) and polled by the runtime
+class FMotionPoseQueue : public IMotionPoseSource
+{
+public:
+
+	void Push(const FMotionPose& Pose) { Queue.Enqueue(Pose); }
+
+	virtual bool Poll(double Now, FMotionPose& Pose) override { return Queue.Dequeue(Pose); }
+
+private:
+
+	TQueue<FMotionPose, EQueueMode::Spsc> Queue;
+};
+
+// Replays a recorded log in real time, one pose per line: Time,X,Y,Z,Pitch,Yaw,Roll
+class FMotionPoseLog : public IMotionPoseSource
+{
+public:
+
+	bool Load(const FString& Filename);
+
+	virtual bool Poll(double Now, FMotionPose& Pose) override;
+	virtual bool IsFinished() const override;
+
+private:
+
+	struct FEntry
+	{
+		double Time;
+		FVector Position;
+		FRotator Rotation;
+	};
+
+	TArray<FEntry> Entries;
+	int32 NextEntry = 0;
+	double StartTime = -1.0;
+};
+
+// Receives poses on a local UDP port, one per datagram, in the sender byte order (loopback only):
+// double Time (s, sender clock), then 6 floats X,Y,Z,Pitch,Yaw,Roll
+class FMotionPoseSocket : public IMotionPoseSource
+{
+public:
+
+	virtual ~FMotionPoseSocket();
+
+	bool Open(int32 Port);
+
+	virtual bool Poll(double Now, FMotionPose& Pose) override;
+
+private:
+
+	FSocket* Socket = nullptr;
+
+	// Sender time of the previous pose
+	double LastPoseTime = -1.0;
+};
+
+// Copy of the runtime state, safe to read from another thread
+struct FMotionRuntimeStats
+{
+	FMotionData CurrentAverage;
+	int TickCount = 0;
+	int TickTotal = 0;
+	EMotionWatchdogState WatchdogState = EMotionWatchdogState::Live;
+	FMotionMetrics Metrics;
+
+	// Effective output rate, and why it last changed
+	int OutputFrequency = 0;
+	EMotionRateReason RateReason = EMotionRateReason::None;
+
+	// Sample points of the latest pose
+	int32 NumPoints = 0;
+	FMotionPointData Points[MaxMotionSamplePoints];
+};
+
+// Runs sampling -> averaging -> interpolation -> watchdog -> host,
+// without any world, actor or timer manager.
+// Tick() is either called by the owner, or at OutputFrequency by the runtime thread after Start().
+class FMotionRuntime : public FRunnable
+{
+public:
+
+	FMotionRuntime(IMotionPoseSource* InSource, int InOutputFrequency);
+	virtual ~FMotionRuntime();
+
+	// Init Host interface and connect to controller
+	void Connect(const FString& ControllerIP, int ControllerPort, int HostReceivePort);
+
+	// Stop the thread if any and clean up the Host interface
+	void Disconnect();
+
+	// One controller tick: poll poses, interpolate and send
+	void Tick();
+
+	// Tick() unless the previous tick is less than half a period ago, for callers that fire in bursts (world timer)
+	// Returns false and counts a late tick when skipped
+	bool TickIfDue();
+
+	// Create the real-time thread, AffinityMask 0 lets the scheduler pick the cores
+	void Start(uint64 AffinityMask);
+
+	// True until stopped or the source is finished
+	bool IsRunning() const { return bRunning; }
+
+	// Configure the watchdog before starting, see TMotionWatchdog
+	void SetWatchdog(float Deadline, float ExtrapolationTime, float WashoutEaseTime, float RecoveryTime);
+
+	// Adapt the output rate within bounds before starting, see FMotionRateController
+	void SetAdaptiveRate(int MinFrequency, int MaxFrequency);
+
+	// Pilot reference point in vehicle space (cm) before starting, where SpecificForce is computed
+	void SetPilotOffset(const FVector& PilotOffset);
+
+	FMotionRuntimeStats GetStats() const;
+
+	// FRunnable implementation
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+
+	// Sleep then spin until the given time (s)
+	void WaitUntil(double Time);
+
+	IMotionPoseSource* Source;
+
+	// Only touched by the thread calling Tick()
+	int OutputFrequency;
+	double LastTickTime = -1.0;
+	bool bAdaptiveRate = false;
+	bool bOutputThread = false;
+	FMotionRateController RateController;
+
+	FMyMotionPipeline Pipeline;
+	TMotionWatchdog<MyMotionHost::Channels> Watchdog;
+	MotionHost* HostInterface = new MyMotionHost();
+	bool bConnected = false;
+	FMotionMetrics Metrics;
+
+	// Written by Tick(), read by GetStats()
+	mutable FCriticalSection StatsLock;
+	FMotionRuntimeStats Stats;
+
+	FRunnableThread* Thread = nullptr;
+	FThreadSafeBool bStopping;
+	FThreadSafeBool bRunning;
+};
@@ -0,0 +1,25 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "MotionRuntimeCommandlet.generated.h"
+
+// Headless motion loop, for dedicated servers and renderer-less simulations
+// Usage: -run=MotionRuntime (-log=<file> | -port=<udp port>) [-frequency=100] [-controllerip=127.0.0.1]
+//        [-controllerport=3000] [-hostport=3001] [-affinity=<mask>] [-duration=<s>]
+//        [-adaptive [-minfrequency=100] [-maxfrequency=1000]]
+//        [-deadline=0.1] [-extrapolation=0.2] [-washoutease=0.5] [-recovery=0.5] (watchdog, s)
+//        [-pilotx=0] [-piloty=0] [-pilotz=0] (pilot offset in vehicle space, cm)
+UCLASS()
+class UMotionRuntimeCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UMotionRuntimeCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
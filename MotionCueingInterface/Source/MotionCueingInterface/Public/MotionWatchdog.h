@@ -0,0 +1,240 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MotionData.h"
+#include "MotionMetrics.h"
+#include "MotionPipeline.h"
+
+// Output side guard against late data (game thread hitch, level streaming, GC...)
+// Live: interpolated data from the pipeline
+// Extrapolating: no sample for SampleInterval + Deadline, keep going along the last segment
+// WashingOut: extrapolation expired, return to neutral under a per channel rate limit, eased in and out
+// Back to Live: when fresh samples make a new average, blend from the last sent data so there is no step
+// The pipeline caps the ticks a hitch adds to a segment (MaxSampleGap), so live output doesn't crawl after a recovery
+
+enum class EMotionWatchdogState : uint8
+{
+	Live,
+	Extrapolating,
+	WashingOut
+};
+
+// Neutral platform pose: level, no motion, only gravity is felt. Position and direction are kept since they carry no cue.
+static inline FMotionData GetNeutralMotionData(const FMotionData& From)
+{
+	FMotionData Neutral;
+	Neutral.Counter = From.Counter;
+	Neutral.MotionStateCommand = From.MotionStateCommand;
+	Neutral.VehiclePosition = From.VehiclePosition;
+	Neutral.VehicleDirection = From.VehicleDirection;
+	Neutral.SpecificForce = FVector(0.0f, 0.0f, MotionGravity);
+	return Neutral;
+}
+
+// Default highest washout rate of each channel, per second in the unit of the channel
+static inline float GetDefaultMotionWashoutRate(uint32 Channel)
+{
+	switch (Channel)
+	{
+	case EMotionChannel::Rotation:					return 3.0f;		// deg/s, below the tilt perception threshold
+	case EMotionChannel::Kinematic:					return 100.0f;
+	case EMotionChannel::Velocity:					return 100.0f;		// cm/s2
+	case EMotionChannel::Acceleration:				return 100.0f;		// cm/s3
+	case EMotionChannel::RotationalDisplacement:	return 3.0f;		// deg/s
+	case EMotionChannel::RotationalVelocity:		return 10.0f;		// deg/s2
+	case EMotionChannel::RotationalAcceleration:	return 50.0f;		// deg/s3
+	case EMotionChannel::SpecificForce:				return 100.0f;		// cm/s3
+	default:										return 1.0e6f;		// no cue, Position and Direction are kept anyway
+	}
+}
+
+template<uint32 Channels>
+class TMotionWatchdog
+{
+public:
+
+	static const int32 NumFloats = MotionChannelFloatCount(Channels);
+
+	TMotionWatchdog()
+	{
+		Deadline = 0.1f;
+		ExtrapolationTime = 0.2f;
+		WashoutEaseTime = 0.5f;
+		RecoveryTime = 0.5f;
+		for (uint32 Channel = 1; Channel <= EMotionChannel::All; Channel <<= 1)
+		{
+			SetWashoutRate(Channel, GetDefaultMotionWashoutRate(Channel));
+		}
+		Reset();
+	}
+
+	// Set the highest washout rate of one consumed channel (a single EMotionChannel bit), per second in the unit of the channel
+	void SetWashoutRate(uint32 Channel, float Rate)
+	{
+		if ((Channels & Channel) == 0)
+		{
+			return;
+		}
+
+		// Index of the first float of that channel in the packed array
+		const int32 First = MotionChannelFloatCount(Channels & (Channel - 1));
+		for (int32 Index = First; Index < First + 3; Index++)
+		{
+			WashoutRate[Index] = FMath::Max(Rate, 0.0f);
+		}
+	}
+
+	void Reset()
+	{
+		State = EMotionWatchdogState::Live;
+		LastUpdateTime = -1.0;
+		MissTime = 0.0;
+		MissAverageTime = 0.0;
+		ExtrapolationT = 1.0f;
+		WashoutElapsed = 0.0f;
+		RecoveryAlpha = 1.0f;
+		LastOutput = GetNeutralMotionData(FMotionData());
+	}
+
+	// Data to send for this controller tick, Now is FPlatformTime::Seconds()
+	FMotionData Update(TMotionPipeline<Channels>& Pipeline, double Now, FMotionMetrics& Metrics)
+	{
+		// Real time since the previous tick, so ramps don't depend on the output rate
+		const float DT = LastUpdateTime < 0.0 ? 0.0f : FMath::Clamp(float(Now - LastUpdateTime), 0.0f, 0.1f);
+		LastUpdateTime = Now;
+
+		// The next sample is expected one nominal interval after the newest one, never a measured period that may span a hitch
+		const double Age = Now - Pipeline.GetLastSampleTime();
+		const bool bFresh = Age <= Pipeline.SampleInterval + Deadline;
+
+		// After a miss, only a new average brings us back, never the stale segment
+		const bool bLive = bFresh && (State == EMotionWatchdogState::Live || Pipeline.GetLastAverageTime() != MissAverageTime);
+
+		FMotionData Out;
+		if (bLive)
+		{
+			if (State != EMotionWatchdogState::Live)
+			{
+				State = EMotionWatchdogState::Live;
+				RecoveryAlpha = 0.0f;
+				Metrics.Recoveries++;
+			}
+
+			Out = Pipeline.NextOutput();
+
+			// Blend from what was sent during the miss
+			if (RecoveryAlpha < 1.0f)
+			{
+				RecoveryAlpha = RecoveryTime > 0.0f ? FMath::Min(RecoveryAlpha + DT / RecoveryTime, 1.0f) : 1.0f;
+				Out = InterpolateMotionData<Channels>(LastOutput, Out, RecoveryAlpha);
+			}
+		}
+		else
+		{
+			Out = KeepGoing(Pipeline, DT, Now, Metrics);
+		}
+
+		LastOutput = Out;
+		Metrics.FramesSent++;
+		return Out;
+	}
+
+	EMotionWatchdogState GetState() const { return State; }
+
+	// Time a sample can be late before extrapolating (s)
+	float Deadline;
+
+	// Time spent extrapolating before washing out (s)
+	float ExtrapolationTime;
+
+	// Time to ease in from the held data to the washout rates, and to ease out near neutral (s)
+	float WashoutEaseTime;
+
+	// Time to blend back to live data once fresh data arrives (s)
+	float RecoveryTime;
+
+private:
+
+	// Extrapolate, then wash out, while no fresh data arrives
+	FMotionData KeepGoing(TMotionPipeline<Channels>& Pipeline, float DT, double Now, FMotionMetrics& Metrics)
+	{
+		if (State == EMotionWatchdogState::Live)
+		{
+			State = EMotionWatchdogState::Extrapolating;
+			ExtrapolationT = Pipeline.GetNextT();
+			MissTime = Now;
+			MissAverageTime = Pipeline.GetLastAverageTime();
+			Metrics.DeadlineMisses++;
+		}
+
+		if (State == EMotionWatchdogState::Extrapolating)
+		{
+			if (Now - MissTime <= ExtrapolationTime)
+			{
+				// Continue along the last segment at the output rate
+				const FMotionData Out = Pipeline.Extrapolate(ExtrapolationT);
+				ExtrapolationT += Pipeline.GetTickStep();
+				return Out;
+			}
+
+			State = EMotionWatchdogState::WashingOut;
+			WashoutElapsed = 0.0f;
+			Metrics.Washouts++;
+		}
+
+		return Washout(DT);
+	}
+
+	// Move every channel toward neutral at no more than its washout rate.
+	// The rate ramps up from the hold over WashoutEaseTime, and near neutral the speed is
+	// proportional to what is left, so the return starts and ends without a velocity step.
+	FMotionData Washout(float DT)
+	{
+		WashoutElapsed += DT;
+		const float EaseIn = WashoutEaseTime > 0.0f ? FMath::SmoothStep(0.0f, WashoutEaseTime, WashoutElapsed) : 1.0f;
+
+		const FMotionData Neutral = GetNeutralMotionData(LastOutput);
+		float Values[NumFloats];
+		float Targets[NumFloats];
+		WriteMotionChannels<Channels>(LastOutput, Values);
+		WriteMotionChannels<Channels>(Neutral, Targets);
+
+		for (int32 Index = 0; Index < NumFloats; Index++)
+		{
+			// Rotation is packed first, its angles wrap around
+			const bool bAngle = (Channels & EMotionChannel::Rotation) && Index < 3;
+			const float Remaining = bAngle ? RotationalDeltaDeg(Targets[Index], Values[Index]) : Targets[Index] - Values[Index];
+
+			float Speed = WashoutRate[Index] * EaseIn;
+			if (WashoutEaseTime > 0.0f)
+			{
+				Speed = FMath::Min(Speed, FMath::Abs(Remaining) / WashoutEaseTime);
+			}
+			const float Step = FMath::Sign(Remaining) * FMath::Min(Speed * DT, FMath::Abs(Remaining));
+			Values[Index] = bAngle ? RotationalAddDeg(Values[Index], Step) : Values[Index] + Step;
+		}
+
+		FMotionData Out = Neutral;
+		ReadMotionChannels<Channels>(Out, Values);
+		return Out;
+	}
+
+	EMotionWatchdogState State;
+	double LastUpdateTime;
+
+	// Time of the deadline miss, and of the newest average at that time
+	double MissTime;
+	double MissAverageTime;
+
+	float ExtrapolationT;
+	float WashoutElapsed;
+	float RecoveryAlpha;
+
+	// Highest washout rate of each float of WriteMotionChannels()
+	float WashoutRate[NumFloats];
+
+	// Last data sent
+	FMotionData LastOutput;
+};
@@ -0,0 +1,21 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "MotionWireBenchmarkCommandlet.generated.h"
+
+// Compares the plain float layout with the compact wire format on a synthetic drive
+// Usage: -run=MotionWireBenchmark [-samples=100000] [-frequency=1000] [-ackdelay=20 (ms)] [-keyframeinterval=100]
+UCLASS()
+class UMotionWireBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UMotionWireBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
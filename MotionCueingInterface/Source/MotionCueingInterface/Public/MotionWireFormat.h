@@ -0,0 +1,433 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformTime.h"
+#include "MotionData.h"
+
+// Optional compact encoding of the consumed channels, for congested or shared links.
+// Every float of WriteMotionChannels() is quantized to 16 bits fixed-point within a configurable range.
+// Keyframe packet: header + int16 per float, a new reference the controller acknowledges with its id
+// Full packet:     header + int16 per float, absolute values while a keyframe is in flight, not a reference
+// Delta packet:    header + int8 per float, difference with the last keyframe acknowledged by the controller
+// Only one keyframe is in flight: it is kept until acknowledged or until KeyframeTimeout, deltas keep
+// using the previous acknowledged keyframe meanwhile, and Full packets are sent when they can't.
+// A new keyframe is sent every KeyframeInterval packets, when none is acknowledged yet,
+// or when a delta gets past half of the 8 bits range, so the ack can come back before deltas overflow.
+// Byte order on the wire is little-endian for every field, whatever the platform.
+// Encoding and decoding never allocate, all buffers are sized from the channel mask.
+
+enum class EMotionWirePacket : uint8
+{
+	Keyframe,
+	Full,
+	Delta
+};
+
+// 5 bytes on the wire: Type, Session, KeyframeId, Sequence (uint16)
+struct FMotionWireHeader
+{
+	static const int32 Size = 5;
+
+	// EMotionWirePacket
+	uint8 Type;
+
+	// Drawn when the encoder is reset, the decoder restarts its sequence when it changes
+	uint8 Session;
+
+	// Id of the keyframe sent, or of the keyframe the delta refers to
+	uint8 KeyframeId;
+
+	// Incremented for every packet, the decoder drops late and duplicate packets and counts losses
+	uint16 Sequence;
+
+	void Write(uint8* Out) const
+	{
+		Out[0] = Type;
+		Out[1] = Session;
+		Out[2] = KeyframeId;
+		Out[3] = uint8(Sequence & 0xFF);
+		Out[4] = uint8(Sequence >> 8);
+	}
+
+	void Read(const uint8* In)
+	{
+		Type = In[0];
+		Session = In[1];
+		KeyframeId = In[2];
+		Sequence = uint16(In[3] | (In[4] << 8));
+	}
+};
+
+// Little-endian int16 array
+static inline void WriteMotionWireInt16(const int16* Values, int32 Num, uint8* Out)
+{
+	for (int32 Index = 0; Index < Num; Index++)
+	{
+		const uint16 Value = uint16(Values[Index]);
+		Out[Index * 2] = uint8(Value & 0xFF);
+		Out[Index * 2 + 1] = uint8(Value >> 8);
+	}
+}
+
+static inline void ReadMotionWireInt16(const uint8* In, int32 Num, int16* Values)
+{
+	for (int32 Index = 0; Index < Num; Index++)
+	{
+		Values[Index] = int16(uint16(In[Index * 2] | (In[Index * 2 + 1] << 8)));
+	}
+}
+
+// Range of the values of a channel, values outside are clamped
+struct FMotionQuantRange
+{
+	float Min;
+	float Max;
+};
+
+// Default range of each channel, in the order of EMotionChannel
+static inline FMotionQuantRange GetDefaultMotionQuantRange(uint32 Channel)
+{
+	switch (Channel)
+	{
+	case EMotionChannel::Rotation:					return { -180.0f, 180.0f };		// deg
+	case EMotionChannel::Direction:					return { -1.0f, 1.0f };
+	case EMotionChannel::Position:					return { -1.0e6f, 1.0e6f };		// cm
+	case EMotionChannel::Kinematic:					return { -1.0e4f, 1.0e4f };		// cm, cm/s, cm/s2
+	case EMotionChannel::Velocity:					return { -1.0e4f, 1.0e4f };		// cm/s
+	case EMotionChannel::Acceleration:				return { -5.0e3f, 5.0e3f };		// cm/s2
+	case EMotionChannel::RotationalDisplacement:	return { -180.0f, 180.0f };		// deg
+	case EMotionChannel::RotationalVelocity:		return { -720.0f, 720.0f };		// deg/s
+	case EMotionChannel::RotationalAcceleration:	return { -3600.0f, 3600.0f };	// deg/s2
+	case EMotionChannel::SpecificForce:				return { -5.0e3f, 5.0e3f };		// cm/s2
+	default:										return { -1.0f, 1.0f };
+	}
+}
+
+// Quantization shared by the encoder and the decoder, both sides must use the same ranges
+template<uint32 Channels>
+class TMotionQuantizer
+{
+public:
+
+	static const int32 NumFloats = MotionChannelFloatCount(Channels);
+
+	TMotionQuantizer()
+	{
+		for (uint32 Channel = 1; Channel <= EMotionChannel::All; Channel <<= 1)
+		{
+			SetRange(Channel, GetDefaultMotionQuantRange(Channel));
+		}
+	}
+
+	// Set the range of one consumed channel (a single EMotionChannel bit)
+	void SetRange(uint32 Channel, const FMotionQuantRange& Range)
+	{
+		if ((Channels & Channel) == 0)
+		{
+			return;
+		}
+
+		// Index of the first float of that channel in the packed array
+		const int32 First = MotionChannelFloatCount(Channels & (Channel - 1));
+		const float HalfRange = FMath::Max((Range.Max - Range.Min) * 0.5f, SMALL_NUMBER);
+		for (int32 Index = First; Index < First + 3; Index++)
+		{
+			Offset[Index] = (Range.Max + Range.Min) * 0.5f;
+			Scale[Index] = 32767.0f / HalfRange;
+			InvScale[Index] = HalfRange / 32767.0f;
+		}
+	}
+
+	// Resolution of a float of the packed array
+	float GetStep(int32 Index) const { return InvScale[Index]; }
+
+	FORCEINLINE void Quantize(const float* Values, int16* Out) const
+	{
+		for (int32 Index = 0; Index < NumFloats; Index++)
+		{
+			const float Scaled = FMath::Clamp((Values[Index] - Offset[Index]) * Scale[Index], -32767.0f, 32767.0f);
+			Out[Index] = (int16)FMath::RoundToInt(Scaled);
+		}
+	}
+
+	FORCEINLINE void Dequantize(const int16* In, float* Values) const
+	{
+		for (int32 Index = 0; Index < NumFloats; Index++)
+		{
+			Values[Index] = In[Index] * InvScale[Index] + Offset[Index];
+		}
+	}
+
+private:
+
+	float Offset[NumFloats];
+	float Scale[NumFloats];
+	float InvScale[NumFloats];
+};
+
+template<uint32 Channels>
+class TMotionWireEncoder
+{
+public:
+
+	static const int32 NumFloats = MotionChannelFloatCount(Channels);
+	static const int32 KeyframeSize = FMotionWireHeader::Size + NumFloats * sizeof(int16);
+	static const int32 DeltaSize = FMotionWireHeader::Size + NumFloats * sizeof(int8);
+	static const int32 MaxPacketSize = KeyframeSize;
+
+	TMotionWireEncoder()
+	{
+		KeyframeInterval = 100;
+		KeyframeTimeout = 0.25f;
+		Reset();
+	}
+
+	void Reset()
+	{
+		// A restarted host must not look like a late packet to a decoder that kept running
+		Session = uint8(FPlatformTime::Cycles() ^ (FPlatformTime::Cycles() >> 8));
+		Sequence = 0;
+		NextKeyframeId = 0;
+		PacketsSinceKeyframe = 0;
+		bHasAckedKeyframe = false;
+		AckedKeyframeId = 0;
+		bKeyframeInFlight = false;
+		InFlightKeyframeId = 0;
+		InFlightTime = 0.0;
+		FMemory::Memzero(AckedKeyframe, sizeof(AckedKeyframe));
+		FMemory::Memzero(InFlightKeyframe, sizeof(InFlightKeyframe));
+	}
+
+	// Encode Data in Out (at least MaxPacketSize bytes), Now is the send time (s), returns the size of the packet
+	int32 Encode(const FMotionData& Data, uint8* Out, double Now)
+	{
+		float Values[NumFloats];
+		int16 Quantized[NumFloats];
+		WriteMotionChannels<Channels>(Data, Values);
+		Quantizer.Quantize(Values, Quantized);
+
+		FMotionWireHeader Header;
+		Header.Session = Session;
+		Header.Sequence = Sequence++;
+
+		// The keyframe in flight is forgotten if its ack doesn't come back in time, a new one can then be sent
+		if (bKeyframeInFlight && Now - InFlightTime > KeyframeTimeout)
+		{
+			bKeyframeInFlight = false;
+		}
+
+		// Deltas against the acknowledged keyframe, Overflow is non zero if one doesn't fit in 8 bits,
+		// HalfOverflow if one doesn't fit in 7 bits: time to send a new keyframe while deltas still fit
+		int8 Deltas[NumFloats];
+		int32 Overflow = 0;
+		int32 HalfOverflow = 0;
+		for (int32 Index = 0; Index < NumFloats; Index++)
+		{
+			const int32 Delta = int32(Quantized[Index]) - int32(AckedKeyframe[Index]);
+			Overflow |= (Delta + 128) & ~0xFF;
+			HalfOverflow |= (Delta + 64) & ~0x7F;
+			Deltas[Index] = (int8)Delta;
+		}
+
+		PacketsSinceKeyframe++;
+		const bool bDelta = bHasAckedKeyframe && Overflow == 0;
+		const bool bNeedKeyframe = !bDelta || HalfOverflow != 0 || PacketsSinceKeyframe >= KeyframeInterval;
+		if (bNeedKeyframe && !bKeyframeInFlight)
+		{
+			// Keep it until the controller acknowledges it
+			Header.Type = (uint8)EMotionWirePacket::Keyframe;
+			Header.KeyframeId = NextKeyframeId++;
+			bKeyframeInFlight = true;
+			InFlightKeyframeId = Header.KeyframeId;
+			InFlightTime = Now;
+			FMemory::Memcpy(InFlightKeyframe, Quantized, sizeof(Quantized));
+			PacketsSinceKeyframe = 0;
+
+			Header.Write(Out);
+			WriteMotionWireInt16(Quantized, NumFloats, Out + FMotionWireHeader::Size);
+			return KeyframeSize;
+		}
+
+		if (!bDelta)
+		{
+			// Waiting for the keyframe in flight, and no usable reference
+			Header.Type = (uint8)EMotionWirePacket::Full;
+			Header.KeyframeId = InFlightKeyframeId;
+			Header.Write(Out);
+			WriteMotionWireInt16(Quantized, NumFloats, Out + FMotionWireHeader::Size);
+			return KeyframeSize;
+		}
+
+		Header.Type = (uint8)EMotionWirePacket::Delta;
+		Header.KeyframeId = AckedKeyframeId;
+		Header.Write(Out);
+		FMemory::Memcpy(Out + FMotionWireHeader::Size, Deltas, sizeof(Deltas));
+		return DeltaSize;
+	}
+
+	// Called when the controller acknowledges a keyframe, deltas are then coded against it
+	void Acknowledge(uint8 KeyframeId)
+	{
+		// Only the keyframe in flight is remembered, older or timed out ids are ignored
+		if (!bKeyframeInFlight || KeyframeId != InFlightKeyframeId)
+		{
+			return;
+		}
+		FMemory::Memcpy(AckedKeyframe, InFlightKeyframe, sizeof(AckedKeyframe));
+		AckedKeyframeId = KeyframeId;
+		bHasAckedKeyframe = true;
+		bKeyframeInFlight = false;
+	}
+
+	// Shared with the decoder
+	TMotionQuantizer<Channels> Quantizer;
+
+	// Packets between two periodic keyframes
+	int32 KeyframeInterval;
+
+	// Time to wait for the ack of a keyframe before sending a new one (s), longer than the round trip
+	float KeyframeTimeout;
+
+private:
+
+	uint8 Session;
+	uint16 Sequence;
+	uint8 NextKeyframeId;
+	int32 PacketsSinceKeyframe;
+
+	bool bHasAckedKeyframe;
+	uint8 AckedKeyframeId;
+	int16 AckedKeyframe[NumFloats];
+
+	bool bKeyframeInFlight;
+	uint8 InFlightKeyframeId;
+	double InFlightTime;
+	int16 InFlightKeyframe[NumFloats];
+};
+
+// Controller side of TMotionWireEncoder
+template<uint32 Channels>
+class TMotionWireDecoder
+{
+public:
+
+	static const int32 NumFloats = MotionChannelFloatCount(Channels);
+
+	TMotionWireDecoder()
+	{
+		Reset();
+	}
+
+	void Reset()
+	{
+		FMemory::Memzero(Keyframes, sizeof(Keyframes));
+		for (int32 Index = 0; Index < NumKeyframes; Index++)
+		{
+			KeyframeIds[Index] = -1;
+		}
+		bHasSequence = false;
+		Session = 0;
+		LastSequence = 0;
+		LostPackets = 0;
+	}
+
+	// Packets missing from the sequence since Reset()
+	uint32 GetLostPackets() const { return LostPackets; }
+
+	// Decode a packet in Out, only the consumed channels are written
+	// OutKeyframeToAck is the id to send back to the encoder, or -1
+	bool Decode(const uint8* Packet, int32 Size, FMotionData& Out, int32& OutKeyframeToAck)
+	{
+		OutKeyframeToAck = -1;
+
+		FMotionWireHeader Header;
+		if (Size < FMotionWireHeader::Size)
+		{
+			return false;
+		}
+		Header.Read(Packet);
+		if (Header.Type > (uint8)EMotionWirePacket::Delta)
+		{
+			return false;
+		}
+
+		// A new session is a restarted encoder, everything known about the previous one is dropped.
+		// So is a keyframe far behind the newest packet: same session drawn again, or a long outage.
+		const int16 Gap = int16(Header.Sequence - LastSequence);
+		const bool bFarBehind = Header.Type != (uint8)EMotionWirePacket::Delta && Gap < -MaxReorder;
+		if (bHasSequence && (Header.Session != Session || bFarBehind))
+		{
+			Reset();
+		}
+
+		// Older than or same as the newest packet: reordered or duplicated by the link
+		if (bHasSequence && Gap <= 0)
+		{
+			return false;
+		}
+
+		const int32 Slot = Header.KeyframeId % NumKeyframes;
+		const uint8* Payload = Packet + FMotionWireHeader::Size;
+		int16 Quantized[NumFloats];
+		if (Header.Type != (uint8)EMotionWirePacket::Delta)
+		{
+			if (Size != TMotionWireEncoder<Channels>::KeyframeSize)
+			{
+				return false;
+			}
+			ReadMotionWireInt16(Payload, NumFloats, Quantized);
+			if (Header.Type == (uint8)EMotionWirePacket::Keyframe)
+			{
+				FMemory::Memcpy(Keyframes[Slot], Quantized, sizeof(Quantized));
+				KeyframeIds[Slot] = Header.KeyframeId;
+				OutKeyframeToAck = Header.KeyframeId;
+			}
+		}
+		else
+		{
+			// Unknown keyframe, lost or too old
+			if (Size != TMotionWireEncoder<Channels>::DeltaSize || KeyframeIds[Slot] != Header.KeyframeId)
+			{
+				return false;
+			}
+			const int8* Deltas = (const int8*)Payload;
+			for (int32 Index = 0; Index < NumFloats; Index++)
+			{
+				Quantized[Index] = int16(Keyframes[Slot][Index] + Deltas[Index]);
+			}
+		}
+
+		if (bHasSequence)
+		{
+			LostPackets += Gap - 1;
+		}
+		bHasSequence = true;
+		Session = Header.Session;
+		LastSequence = Header.Sequence;
+
+		float Values[NumFloats];
+		Quantizer.Dequantize(Quantized, Values);
+		ReadMotionChannels<Channels>(Out, Values);
+		return true;
+	}
+
+	// Same ranges as the encoder
+	TMotionQuantizer<Channels> Quantizer;
+
+private:
+
+	static const int32 NumKeyframes = 8;
+
+	// Packets a link can deliver late, anything further behind is a resync
+	static const int16 MaxReorder = 256;
+
+	int16 Keyframes[NumKeyframes][NumFloats];
+	int32 KeyframeIds[NumKeyframes];
+
+	bool bHasSequence;
+	uint8 Session;
+	uint16 LastSequence;
+	uint32 LostPackets;
+};
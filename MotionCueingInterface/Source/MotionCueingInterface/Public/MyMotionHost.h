@@ -1,6 +1,10 @@
 // Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
 
+#pragma once
+
 #include "MotionHost.h"
+#include "MotionPipeline.h"
+#include "MotionWireFormat.h"
 
 #if WITH_THEAPI
 // add API include here
@@ -13,11 +17,32 @@
 
 class MyMotionHost : public MotionHost
 {
+public:
+
+	// Declare the channels your controller consumes, for example:
+	// EMotionChannel::Rotation | EMotionChannel::Acceleration
+	static const uint32 Channels = EMotionChannel::All;
+
+	// Send quantized keyframes and deltas instead of floats, if your controller decodes TMotionWireDecoder packets
+	bool UseCompactEncoding = false;
+
+	// Compact encoding of the consumed channels, set Encoder.Quantizer ranges, Encoder.KeyframeInterval and
+	// Encoder.KeyframeTimeout (above the round trip) in Initialize(), the controller decoder must use the same ranges
+	TMotionWireEncoder<Channels> Encoder;
+
 private:
 
+	// Consumed channels packed in the order of EMotionChannel
+	float PackedData[MotionChannelFloatCount(Channels)];
+
+	// Last compact packet
+	uint8 WirePacket[TMotionWireEncoder<Channels>::MaxPacketSize];
+	int32 WirePacketSize = 0;
+
 	virtual void MapData(FMotionData& Data) override
 	{
 		// Map data from Unreal to your API data structure
+		WriteMotionChannels<Channels>(Data, PackedData);
 		// ...
 
 
@@ -30,6 +55,9 @@ public:
 		// Initialize your API object here
 		// ...
 
+		// With compact encoding, restart from a keyframe and narrow the ranges to your vehicle, for example:
+		// Encoder.Quantizer.SetRange(EMotionChannel::Acceleration, { -2000.0f, 2000.0f });
+		Encoder.Reset();
 	}
 
 	virtual void Cleanup() override
@@ -51,9 +79,23 @@ public:
 		// Read data from controller
 		// ...
 
+		// With compact encoding, forward the keyframe ids acknowledged by the controller
+		int32 AckedKeyframeId = -1;
+		// AckedKeyframeId = ...
+		AcknowledgeKeyframe(AckedKeyframeId);
+
 	}
 
 
+	// Deltas are only sent once the controller acknowledged a keyframe, KeyframeId < 0 if none was received
+	void AcknowledgeKeyframe(int32 KeyframeId)
+	{
+		if (UseCompactEncoding && KeyframeId >= 0)
+		{
+			Encoder.Acknowledge((uint8)KeyframeId);
+		}
+	}
+
 	virtual void SetStateFlow() override
 	{
 		// If required, go through a state flow in a specific order before sending/receiving data to the controller
@@ -61,8 +103,33 @@ public:
 
 	}
 
+	virtual bool GetFeedback(FMotionFeedback& Feedback) override
+	{
+		// If your controller reports acks and its queue, fill Feedback and return true to adapt the output rate
+		// ...
+
+		return false;
+	}
+
+	virtual void SetSamplePoints(const FMotionPointData* Points, int32 NumPoints) override
+	{
+		// If your controller takes cues from several points (seat, head...), map Points[i].SpecificForce here
+		// ...
+
+	}
+
 	virtual void SendDataToController(FMotionData& Data) override
 	{
+		if (UseCompactEncoding)
+		{
+			// Encode data for the controller
+			WirePacketSize = Encoder.Encode(Data, WirePacket, FPlatformTime::Seconds());
+
+			// Send WirePacketSize bytes of WirePacket
+			// ...
+			return;
+		}
+
 		// Map data from Unreal to Controller
 		MapData(Data);
 
@@ -71,3 +138,6 @@ public:
 		// ...
 	}
 };
+
+// Pipeline computing the channels consumed by MyMotionHost
+typedef TMotionPipeline<MyMotionHost::Channels> FMyMotionPipeline;
@@ -39,5 +39,10 @@ public class TheAPI : ModuleRules
 			//PublicDefinitions.Add("_WIN32_WINNT_WIN10_RS4");
 			//PublicDefinitions.Add("_WIN32_WINNT_WIN10_RS5");
         }
+        else
+        {
+            // TheAPI is only available on Windows, MyMotionHost compiles without it
+            PublicDefinitions.Add("WITH_THEAPI=0");
+        }
     }
 }